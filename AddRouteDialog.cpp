@@ -94,6 +94,10 @@ void AddRouteDialog::setupUI() {
     timeLayout->addStretch();
     scheduleLayout->addRow("Время начала работы:", timeLayout);
 
+    extraDeparturesEdit = new QLineEdit;
+    extraDeparturesEdit->setPlaceholderText("Дополнительные рейсы через запятую (например: 07:00, 08:30, 09:00-21:00/7)");
+    scheduleLayout->addRow("Другие отправления:", extraDeparturesEdit);
+
     mainLayout->addWidget(scheduleGroup);
 
     // Buttons
@@ -173,6 +177,13 @@ bool AddRouteDialog::validateInput() {
         return false;
     }
 
+    QVector<FrequencyTrip> frequencies;
+    if (bool departuresOk = true; parseDepartures(&departuresOk, &frequencies), !departuresOk) {
+        QMessageBox::warning(this, "Ошибка",
+                             "Неверный формат дополнительных отправлений (ожидается ЧЧ:ММ или ЧЧ:ММ-ЧЧ:ММ/интервал через запятую)");
+        return false;
+    }
+
     auto intermediateStops = getIntermediateStops();
     if (auto totalStops = 1 + intermediateStops.size() + 1; travelTimes.size() != totalStops - 1) {
         QMessageBox::warning(this, "Ошибка",
@@ -201,9 +212,13 @@ void AddRouteDialog::createAndAddRoute() {
     auto intermediateStops = getIntermediateStops();
     auto travelTimes = parseTravelTimes();
     auto days = parseDays();
+    if (auto daysValidation = ValidationService::validateDays(days); !daysValidation.isValid) {
+        throw InvalidRouteDataException(daysValidation.errorMessage);
+    }
 
-    // Create start time
-    TimeTransport startTime(startHourSpin->value(), startMinuteSpin->value());
+    // Первый рейс задается спинбоксами, остальные - строкой отправлений и интервалов
+    QVector<FrequencyTrip> frequencies;
+    auto departures = parseDepartures(nullptr, &frequencies);
 
     TransportSchedule::RouteParams params(
         transport,
@@ -211,8 +226,9 @@ void AddRouteDialog::createAndAddRoute() {
         endStop,
         intermediateStops,
         travelTimes,
-        days,
-        startTime
+        DayMask::fromStringList(days),
+        departures,
+        frequencies
         );
 
     schedule->addRoute(params);
@@ -230,6 +246,13 @@ QVector<QSharedPointer<Stop>> AddRouteDialog::getIntermediateStops() const {
     return intermediateStops;
 }
 
+QVector<TimeTransport> AddRouteDialog::parseDepartures(bool* ok, QVector<FrequencyTrip>* frequencies) const {
+    QVector<TimeTransport> departures;
+    departures.push_back(TimeTransport(startHourSpin->value(), startMinuteSpin->value()));
+    departures += ArrivalTimeService::parseDepartures(extraDeparturesEdit->text(), ok, frequencies);
+    return departures;
+}
+
 QVector<int> AddRouteDialog::parseTravelTimes() const {
     QVector<int> travelTimes;
     const QStringList timeStrings = travelTimesEdit->text().split(",");
@@ -34,6 +34,7 @@ private:
     QVector<QSharedPointer<Stop>> getIntermediateStops() const;
     QVector<int> parseTravelTimes() const;
     QStringList parseDays() const;
+    QVector<TimeTransport> parseDepartures(bool* ok = nullptr, QVector<FrequencyTrip>* frequencies = nullptr) const;
 
     TransportSchedule* schedule;
 
@@ -50,6 +51,7 @@ private:
     QLineEdit* daysEdit;
     QSpinBox* startHourSpin;
     QSpinBox* startMinuteSpin;
+    QLineEdit* extraDeparturesEdit;
 };
 
 #endif
@@ -1,6 +1,8 @@
 #include "ArrivalTimeService.h"
+#include "Schedule.h"
 #include <QString>
 #include <algorithm>
+#include <optional>
 
 // Определение констант
 constexpr int ArrivalTimeService::MINUTES_IN_HOUR;
@@ -9,29 +11,17 @@ constexpr int ArrivalTimeService::MINUTES_IN_DAY;
 
 TimeTransport ArrivalTimeService::calculateArrivalTime(const Route& route, int stopIndex, const TimeTransport& startTime)
 {
-    if (stopIndex == 0) {
-        return startTime;
-    }
-
-    auto travelTimes = route.getTravelTimes();
-    TimeTransport currentTime = startTime;
-
-    const auto maxIndex = std::min(stopIndex, static_cast<int>(travelTimes.size()));
-    for (int i = 0; i < maxIndex; ++i) {
-        currentTime = currentTime.addMinutes(travelTimes[i]);
-    }
-
-    return currentTime;
+    return startTime.addMinutes(calculateTravelTimeToStop(route, stopIndex));
 }
 
 QVector<TimeTransport> ArrivalTimeService::calculateAllArrivalTimes(const Route& route, const TimeTransport& startTime)
 {
     QVector<TimeTransport> arrivalTimes;
-    auto stops = route.getStops();
+    const auto offsets = route.getOffsets();
 
-    arrivalTimes.reserve(stops.size());
-    for (int i = 0; i < stops.size(); ++i) {
-        arrivalTimes.append(calculateArrivalTime(route, i, startTime));
+    arrivalTimes.reserve(static_cast<int>(offsets.size()));
+    for (int offset : offsets) {
+        arrivalTimes.append(startTime.addMinutes(offset));
     }
 
     return arrivalTimes;
@@ -41,15 +31,9 @@ int ArrivalTimeService::calculateTravelTimeToStop(const Route& route, int stopIn
 {
     if (stopIndex <= 0) return 0;
 
-    auto travelTimes = route.getTravelTimes();
-    int totalTime = 0;
-
-    const auto maxIndex = std::min(stopIndex, static_cast<int>(travelTimes.size()));
-    for (int i = 0; i < maxIndex; ++i) {
-        totalTime += travelTimes[i];
-    }
-
-    return totalTime;
+    // Смещения накоплены в маршруте, индекс за концом ограничиваем последней остановкой
+    const auto offsets = route.getOffsets();
+    return offsets[std::min(stopIndex, static_cast<int>(offsets.size()) - 1)];
 }
 
 TimeTransport ArrivalTimeService::addTravelTime(const TimeTransport& startTime, int travelMinutes)
@@ -80,3 +64,92 @@ QString ArrivalTimeService::formatWaitTime(int waitMinutes)
         return QString("%1 мин").arg(waitMinutes);
     }
 }
+
+QString ArrivalTimeService::formatDepartures(std::span<const TimeTransport> departures)
+{
+    if (departures.empty()) {
+        return QString();
+    }
+    if (departures.size() == 1) {
+        return departures.front().toString();
+    }
+    return QString("%1 – %2 (рейсов: %3)")
+        .arg(departures.front().toString(), departures.back().toString())
+        .arg(departures.size());
+}
+
+QString ArrivalTimeService::formatTrips(const Schedule& schedule)
+{
+    QStringList parts;
+    if (auto departures = formatDepartures(schedule.getDepartures()); !departures.isEmpty()) {
+        parts << departures;
+    }
+    for (const auto& frequency : schedule.getFrequencies()) {
+        parts << frequency.toString();
+    }
+    return parts.join("; ");
+}
+
+QVector<TimeTransport> ArrivalTimeService::parseDepartures(const QString& departuresString, bool* ok,
+                                                           QVector<FrequencyTrip>* frequencies)
+{
+    QVector<TimeTransport> departures;
+    if (ok) {
+        *ok = true;
+    }
+
+    // Поддержка форматов: "07:00, 08:30" или "07:00;08:30"
+    auto normalized = departuresString;
+    normalized = normalized.replace(';', ',');
+    const QStringList parts = normalized.split(',', Qt::SkipEmptyParts);
+
+    auto parseTime = [](const QString& text) -> std::optional<TimeTransport> {
+        const QStringList timeParts = text.trimmed().split(':');
+        bool hoursOk = false;
+        bool minutesOk = false;
+        const int hours = timeParts.value(0).toInt(&hoursOk);
+        const int minutes = timeParts.value(1).toInt(&minutesOk);
+
+        if (timeParts.size() != 2 || !hoursOk || !minutesOk
+            || hours < TimeTransport::MIN_HOURS || hours > TimeTransport::MAX_HOURS
+            || minutes < TimeTransport::MIN_MINUTES || minutes > TimeTransport::MAX_MINUTES) {
+            return std::nullopt;
+        }
+        return TimeTransport(hours, minutes);
+    };
+
+    for (const auto& part : parts) {
+        // Частотный интервал: "начало-окончание/интервал"
+        if (frequencies && part.contains('/')) {
+            const QStringList rangeAndHeadway = part.trimmed().split('/');
+            const QStringList range = rangeAndHeadway.value(0).split('-');
+            bool headwayOk = false;
+            const int headway = rangeAndHeadway.value(1).trimmed().toInt(&headwayOk);
+            auto start = parseTime(range.value(0));
+            auto end = parseTime(range.value(1));
+
+            if (rangeAndHeadway.size() == 2 && range.size() == 2 && headwayOk && start && end) {
+                FrequencyTrip frequency(*start, *end, headway);
+                if (frequency.isValid()) {
+                    frequencies->push_back(frequency);
+                    continue;
+                }
+            }
+            if (ok) {
+                *ok = false;
+            }
+            continue;
+        }
+
+        auto departure = parseTime(part);
+        if (!departure) {
+            if (ok) {
+                *ok = false;
+            }
+            continue;
+        }
+        departures.push_back(*departure);
+    }
+
+    return departures;
+}
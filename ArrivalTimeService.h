@@ -3,7 +3,11 @@
 
 #include "Route.h"
 #include "TimeTransport.h"
+#include "FrequencyTrip.h"
 #include <QVector>
+#include <span>
+
+class Schedule;
 
 class ArrivalTimeService
 {
@@ -19,6 +23,11 @@ public:
     static TimeTransport addTravelTime(const TimeTransport& startTime, int travelMinutes);
     static int calculateWaitTime(const TimeTransport& currentTime, const TimeTransport& arrivalTime);
     static QString formatWaitTime(int waitMinutes);
+    static QString formatDepartures(std::span<const TimeTransport> departures);
+    static QString formatTrips(const Schedule& schedule);
+    // Формат: "07:00, 08:30"; при frequencies != nullptr допускаются интервалы "06:00-21:00/7"
+    static QVector<TimeTransport> parseDepartures(const QString& departuresString, bool* ok = nullptr,
+                                                  QVector<FrequencyTrip>* frequencies = nullptr);
 };
 
 #endif // ARRIVALTIMESERVICE_H
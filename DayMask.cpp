@@ -0,0 +1,45 @@
+#include "DayMask.h"
+#include "DayOfWeekService.h"
+
+DayMask DayMask::fromDayOfWeek(int dayOfWeek)
+{
+    if (dayOfWeek < 1 || dayOfWeek > DAYS_IN_WEEK) {
+        return DayMask();
+    }
+    return DayMask(static_cast<std::uint8_t>(1u << (dayOfWeek - 1)));
+}
+
+DayMask DayMask::fromStringList(const QStringList& days, QStringList* invalidDays)
+{
+    const QStringList dayNames = DayOfWeekService::getAllDays();
+    DayMask mask;
+
+    for (const QString& day : days) {
+        const auto index = dayNames.indexOf(DayOfWeekService::translateDay(day.trimmed()));
+        if (index < 0) {
+            if (invalidDays) {
+                invalidDays->push_back(day);
+            }
+            continue;
+        }
+        mask = mask | fromDayOfWeek(static_cast<int>(index) + 1);
+    }
+
+    return mask;
+}
+
+QStringList DayMask::toStringList() const
+{
+    QStringList result;
+    for (int day = 1; day <= DAYS_IN_WEEK; ++day) {
+        if (contains(day)) {
+            result.push_back(DayOfWeekService::getDayName(day));
+        }
+    }
+    return result;
+}
+
+QString DayMask::toString() const
+{
+    return DayOfWeekService::formatDays(toStringList());
+}
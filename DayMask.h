@@ -0,0 +1,42 @@
+#ifndef DAYMASK_H
+#define DAYMASK_H
+
+#include <QString>
+#include <QStringList>
+#include <bit>
+#include <cstdint>
+
+// Компактный набор дней работы маршрута: бит 0 - понедельник, ..., бит 6 - воскресенье.
+// Строковые названия дней используются только на границе с UI и файлами.
+class DayMask {
+public:
+    static constexpr int DAYS_IN_WEEK = 7;
+    static constexpr std::uint8_t ALL_DAYS = 0x7F;
+
+    constexpr DayMask() = default;
+    constexpr explicit DayMask(std::uint8_t value) : bits(value & ALL_DAYS) {}
+
+    // dayOfWeek в нумерации QDate: 1 - понедельник, 7 - воскресенье
+    static DayMask fromDayOfWeek(int dayOfWeek);
+    static DayMask fromStringList(const QStringList& days, QStringList* invalidDays = nullptr);
+
+    QStringList toStringList() const;
+    QString toString() const;
+
+    constexpr bool contains(int dayOfWeek) const {
+        return dayOfWeek >= 1 && dayOfWeek <= DAYS_IN_WEEK && (bits & (1u << (dayOfWeek - 1))) != 0;
+    }
+    constexpr bool intersects(DayMask other) const { return (bits & other.bits) != 0; }
+    constexpr bool isEmpty() const { return bits == 0; }
+    constexpr int count() const { return std::popcount(bits); }
+    constexpr std::uint8_t toBits() const { return bits; }
+
+    constexpr DayMask operator|(DayMask other) const { return DayMask(bits | other.bits); }
+    constexpr DayMask operator&(DayMask other) const { return DayMask(bits & other.bits); }
+    constexpr bool operator==(const DayMask& other) const = default;
+
+private:
+    std::uint8_t bits = 0;
+};
+
+#endif // DAYMASK_H
@@ -10,6 +10,11 @@ QString DayOfWeekService::getCurrentDay()
     return getDayName(dayOfWeek);
 }
 
+DayMask DayOfWeekService::getCurrentDayMask()
+{
+    return DayMask::fromDayOfWeek(QDate::currentDate().dayOfWeek());
+}
+
 QStringList DayOfWeekService::getAllDays()
 {
     return {"пн", "вт", "ср", "чт", "пт", "сб", "вс"};
@@ -37,10 +42,9 @@ QString DayOfWeekService::formatDays(const QStringList& days)
     return days.join(", ");
 }
 
-bool DayOfWeekService::isRouteActiveToday(const QStringList& routeDays)
+bool DayOfWeekService::isRouteActiveToday(DayMask routeDays)
 {
-    QString currentDay = getCurrentDay();
-    return isDayInList(currentDay, routeDays);
+    return routeDays.intersects(getCurrentDayMask());
 }
 
 bool DayOfWeekService::isDayInList(const QString& day, const QStringList& daysList)
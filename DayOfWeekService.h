@@ -4,15 +4,17 @@
 #include <QString>
 #include <QStringList>
 #include <QDate>
+#include "DayMask.h"
 
 class DayOfWeekService
 {
 public:
     static QString getCurrentDay();
+    static DayMask getCurrentDayMask();
     static QStringList getAllDays();
     static QStringList parseDaysString(const QString& daysString);
     static QString formatDays(const QStringList& days);
-    static bool isRouteActiveToday(const QStringList& routeDays);
+    static bool isRouteActiveToday(DayMask routeDays);
     static bool isDayInList(const QString& day, const QStringList& daysList);
     static QString translateDay(const QString& day);
     static QString getDayName(int dayOfWeek);
@@ -0,0 +1,231 @@
+#include "DepartureIndex.h"
+#include "ArrivalTimeService.h"
+#include <QSet>
+#include <algorithm>
+
+namespace {
+bool entryLess(const DepartureIndex::Entry& a, const DepartureIndex::Entry& b)
+{
+    return a.minuteOfDay < b.minuteOfDay;
+}
+}
+
+void DepartureIndex::build(const QVector<Schedule>& schedules)
+{
+    clear();
+    entriesByStop.resize(StopRegistry::instance().size());
+    frequenciesByStop.resize(StopRegistry::instance().size());
+
+    for (int i = 0; i < schedules.size(); ++i) {
+        addSchedule(i, schedules[i]);
+    }
+}
+
+void DepartureIndex::clear()
+{
+    entriesByStop.clear();
+    frequenciesByStop.clear();
+}
+
+void DepartureIndex::ensureStop(StopId stopId)
+{
+    if (stopId >= static_cast<StopId>(entriesByStop.size())) {
+        const int size = std::max(StopRegistry::instance().size(), static_cast<int>(stopId) + 1);
+        entriesByStop.resize(size);
+        frequenciesByStop.resize(size);
+    }
+}
+
+void DepartureIndex::addSchedule(int scheduleIndex, const Schedule& schedule)
+{
+    const auto& route = schedule.getRoute();
+    const auto stops = route.getStops();
+    const auto departures = schedule.getDepartures();
+    const auto frequencies = schedule.getFrequencies();
+    const int minutesPerDay = ArrivalTimeService::MINUTES_IN_DAY;
+
+    for (int stopIndex = 0; stopIndex < static_cast<int>(stops.size()); ++stopIndex) {
+        const StopId stopId = stops[stopIndex].stopId;
+        const int offset = route.getOffsetAtStop(stopIndex);
+        ensureStop(stopId);
+
+        // Сортируем только новые записи (переход через полночь нарушает порядок)
+        // и сливаем их с уже отсортированными
+        QVector<Entry>& entries = entriesByStop[stopId];
+        const auto oldSize = entries.size();
+        for (int trip = 0; trip < static_cast<int>(departures.size()); ++trip) {
+            entries.push_back(Entry{(departures[trip].toMinutes() + offset) % minutesPerDay,
+                                    scheduleIndex, stopIndex, trip});
+        }
+        std::sort(entries.begin() + oldSize, entries.end(), entryLess);
+        std::inplace_merge(entries.begin(), entries.begin() + oldSize, entries.end(), entryLess);
+
+        int firstTripIndex = static_cast<int>(departures.size());
+        for (int f = 0; f < static_cast<int>(frequencies.size()); ++f) {
+            frequenciesByStop[stopId].push_back(FrequencyRef{scheduleIndex, stopIndex, f, firstTripIndex, offset});
+            firstTripIndex += frequencies[f].getTripCount();
+        }
+    }
+}
+
+void DepartureIndex::updateSchedule(int scheduleIndex, const Schedule& schedule)
+{
+    removeSchedule(scheduleIndex, schedule);
+    addSchedule(scheduleIndex, schedule);
+}
+
+void DepartureIndex::removeSchedule(int scheduleIndex, const Schedule& schedule)
+{
+    for (const auto& routeStop : schedule.getRoute().getStops()) {
+        if (routeStop.stopId >= static_cast<StopId>(entriesByStop.size())) {
+            continue;
+        }
+
+        auto& entries = entriesByStop[routeStop.stopId];
+        auto [first, last] = std::ranges::remove_if(entries, [scheduleIndex](const Entry& e) {
+            return e.scheduleIndex == scheduleIndex;
+        });
+        entries.erase(first, last);
+
+        auto& refs = frequenciesByStop[routeStop.stopId];
+        auto [firstRef, lastRef] = std::ranges::remove_if(refs, [scheduleIndex](const FrequencyRef& r) {
+            return r.scheduleIndex == scheduleIndex;
+        });
+        refs.erase(firstRef, lastRef);
+    }
+}
+
+void DepartureIndex::moveSchedule(int fromIndex, int toIndex, const Schedule& schedule)
+{
+    // Записи упорядочены по минуте, поэтому смена индекса расписания порядок не нарушает
+    for (const auto& routeStop : schedule.getRoute().getStops()) {
+        if (routeStop.stopId >= static_cast<StopId>(entriesByStop.size())) {
+            continue;
+        }
+        for (auto& e : entriesByStop[routeStop.stopId]) {
+            if (e.scheduleIndex == fromIndex) e.scheduleIndex = toIndex;
+        }
+        for (auto& r : frequenciesByStop[routeStop.stopId]) {
+            if (r.scheduleIndex == fromIndex) r.scheduleIndex = toIndex;
+        }
+    }
+}
+
+std::span<const DepartureIndex::FrequencyRef> DepartureIndex::frequenciesForStop(StopId stopId) const
+{
+    if (stopId >= static_cast<StopId>(frequenciesByStop.size())) {
+        return {};
+    }
+    const auto& frequencies = frequenciesByStop[stopId];
+    return {frequencies.constData(), static_cast<std::size_t>(frequencies.size())};
+}
+
+void DepartureIndex::assignStop(StopId stopId, std::span<const Entry> entries, std::span<const FrequencyRef> frequencies)
+{
+    ensureStop(stopId);
+    entriesByStop[stopId] = QVector<Entry>(entries.begin(), entries.end());
+    frequenciesByStop[stopId] = QVector<FrequencyRef>(frequencies.begin(), frequencies.end());
+}
+
+std::span<const DepartureIndex::Entry> DepartureIndex::entriesForStop(StopId stopId) const
+{
+    if (stopId >= static_cast<StopId>(entriesByStop.size())) {
+        return {};
+    }
+    const auto& entries = entriesByStop[stopId];
+    return {entries.constData(), static_cast<std::size_t>(entries.size())};
+}
+
+QVector<TripArrival> DepartureIndex::nextArrivals(StopId stopId, const TimeTransport& currentTime, DayMask days,
+                                                  const QVector<Schedule>& schedules, int limit) const
+{
+    return collectArrivals(stopId, currentTime, days, schedules, limit, false);
+}
+
+QVector<TripArrival> DepartureIndex::nextArrivalPerSchedule(StopId stopId, const TimeTransport& currentTime, DayMask days,
+                                                            const QVector<Schedule>& schedules) const
+{
+    return collectArrivals(stopId, currentTime, days, schedules, -1, true);
+}
+
+QVector<TripArrival> DepartureIndex::collectArrivals(StopId stopId, const TimeTransport& currentTime, DayMask days,
+                                                     const QVector<Schedule>& schedules, int limit,
+                                                     bool onePerSchedule) const
+{
+    QVector<TripArrival> result;
+    if (stopId >= static_cast<StopId>(entriesByStop.size())) {
+        return result;
+    }
+
+    const int minutesPerDay = ArrivalTimeService::MINUTES_IN_DAY;
+    const int nowMinutes = currentTime.toMinutes();
+    QSet<int> seenSchedules;
+
+    // Явные рейсы: бинарный поиск текущей минуты, затем обход по кругу суток
+    const auto& entries = entriesByStop[stopId];
+    const auto start = std::lower_bound(entries.begin(), entries.end(), Entry{nowMinutes, 0, 0, 0}, entryLess)
+                       - entries.begin();
+    for (qsizetype k = 0; k < entries.size(); ++k) {
+        if (!onePerSchedule && limit > 0 && result.size() >= limit) {
+            break;
+        }
+
+        const Entry& e = entries[(start + k) % entries.size()];
+        const Schedule& schedule = schedules[e.scheduleIndex];
+        if (!schedule.getRoute().getDays().intersects(days)) {
+            continue;
+        }
+        if (onePerSchedule) {
+            if (seenSchedules.contains(e.scheduleIndex)) {
+                continue;
+            }
+            seenSchedules.insert(e.scheduleIndex);
+        }
+
+        const TimeTransport arrivalTime(0, e.minuteOfDay);
+        result.push_back(TripArrival{&schedule, e.tripIndex, arrivalTime,
+                                     ArrivalTimeService::calculateWaitTime(currentTime, arrivalTime)});
+    }
+
+    // Частотные рейсы считаются арифметически для каждого интервала
+    for (const auto& ref : frequenciesByStop[stopId]) {
+        const Schedule& schedule = schedules[ref.scheduleIndex];
+        if (!schedule.getRoute().getDays().intersects(days)) {
+            continue;
+        }
+
+        const FrequencyTrip& frequency = schedule.getFrequencies()[ref.frequencyIndex];
+        const int tripCount = frequency.getTripCount();
+        if (tripCount == 0) {
+            continue;
+        }
+
+        const int target = ((nowMinutes - ref.offset) % minutesPerDay + minutesPerDay) % minutesPerDay;
+        const int firstTrip = frequency.firstTripAtOrAfter(target).value_or(0);
+        const int wanted = onePerSchedule ? 1 : (limit > 0 ? std::min(limit, tripCount) : tripCount);
+
+        for (int n = 0; n < wanted; ++n) {
+            const int trip = (firstTrip + n) % tripCount;
+            const TimeTransport arrivalTime = frequency.getDeparture(trip).addMinutes(ref.offset);
+            result.push_back(TripArrival{&schedule, ref.firstTripIndex + trip, arrivalTime,
+                                         ArrivalTimeService::calculateWaitTime(currentTime, arrivalTime)});
+        }
+    }
+
+    std::ranges::stable_sort(result, {}, &TripArrival::waitMinutes);
+
+    if (onePerSchedule) {
+        // После сортировки первым для каждого расписания идет ближайший рейс
+        QSet<const Schedule*> seen;
+        auto [first, last] = std::ranges::remove_if(result, [&seen](const TripArrival& arrival) {
+            if (seen.contains(arrival.schedule)) return true;
+            seen.insert(arrival.schedule);
+            return false;
+        });
+        result.erase(first, last);
+    } else if (limit > 0 && result.size() > limit) {
+        result.resize(limit);
+    }
+
+    return result;
+}
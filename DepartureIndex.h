@@ -0,0 +1,66 @@
+#ifndef DEPARTUREINDEX_H
+#define DEPARTUREINDEX_H
+
+#include <QVector>
+#include <span>
+#include "Schedule.h"
+#include "StopRegistry.h"
+#include "DayMask.h"
+
+// Индекс отправлений по остановкам: для каждого StopId хранится
+// отсортированный по минуте суток массив прибытий явных рейсов.
+// Частотные рейсы не разворачиваются - для них хранится ссылка на интервал.
+// Расписания адресуются индексом в векторе TransportSchedule::schedules.
+class DepartureIndex
+{
+public:
+    struct Entry {
+        int minuteOfDay;
+        int scheduleIndex;
+        int stopIndex;
+        int tripIndex;
+    };
+
+    struct FrequencyRef {
+        int scheduleIndex;
+        int stopIndex;
+        int frequencyIndex;
+        int firstTripIndex;
+        int offset;
+    };
+
+    void build(const QVector<Schedule>& schedules);
+    void clear();
+
+    // Изменения затрагивают только остановки маршрута расписания
+    void addSchedule(int scheduleIndex, const Schedule& schedule);
+    // Маршрут расписания не меняется, добавляются только рейсы
+    void updateSchedule(int scheduleIndex, const Schedule& schedule);
+    void removeSchedule(int scheduleIndex, const Schedule& schedule);
+    // Перенумерация расписания (например, при переносе последнего на место удаленного)
+    void moveSchedule(int fromIndex, int toIndex, const Schedule& schedule);
+
+    std::span<const Entry> entriesForStop(StopId stopId) const;
+    std::span<const FrequencyRef> frequenciesForStop(StopId stopId) const;
+
+    // Загрузка готовых (уже отсортированных) списков остановки, например из файла индекса
+    void assignStop(StopId stopId, std::span<const Entry> entries, std::span<const FrequencyRef> frequencies);
+
+    // Ближайшие limit прибытий на остановку (несколько рейсов одного маршрута допускаются)
+    QVector<TripArrival> nextArrivals(StopId stopId, const TimeTransport& currentTime, DayMask days,
+                                      const QVector<Schedule>& schedules, int limit) const;
+    // Ближайшее прибытие каждого маршрута, проходящего через остановку
+    QVector<TripArrival> nextArrivalPerSchedule(StopId stopId, const TimeTransport& currentTime, DayMask days,
+                                                const QVector<Schedule>& schedules) const;
+
+private:
+    QVector<TripArrival> collectArrivals(StopId stopId, const TimeTransport& currentTime, DayMask days,
+                                         const QVector<Schedule>& schedules, int limit,
+                                         bool onePerSchedule) const;
+    void ensureStop(StopId stopId);
+
+    QVector<QVector<Entry>> entriesByStop;
+    QVector<QVector<FrequencyRef>> frequenciesByStop;
+};
+
+#endif // DEPARTUREINDEX_H
@@ -57,7 +57,7 @@ void FindTransportDialog::setupUI() {
     allRoutesTable = new QTableWidget;
     allRoutesTable->setColumnCount(6);
     QStringList allRoutesHeaders;
-    allRoutesHeaders << "Маршрут" << "Тип" << "Начальная остановка" << "Конечная остановка" << "Время начала" << "Дни работы";
+    allRoutesHeaders << "Маршрут" << "Тип" << "Начальная остановка" << "Конечная остановка" << "Отправления" << "Дни работы";
     allRoutesTable->setHorizontalHeaderLabels(allRoutesHeaders);
     allRoutesTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
     allRoutesTable->horizontalHeader()->setStretchLastSection(true);
@@ -71,17 +71,13 @@ void FindTransportDialog::setupUI() {
     mainLayout->addWidget(tabWidget);
 }
 
-// Новый метод для вычисления времени прибытия
-std::optional<TimeTransport> FindTransportDialog::calculateArrivalTime(const Route& route, const QString& stopName) {
-    try {
-        return route.getArrivalTimeAtStop(stopName);
-    } catch (const StopNotFoundException& e) {
-        qDebug() << "Остановка не найдена в маршруте:" << e.what();
-        return std::nullopt;
-    }
-}
-
+// Заполнение списка остановок активными остановками, отсортированными по названию
 void FindTransportDialog::updateStopsCombo() {
+    // Список активных остановок не менялся с прошлого заполнения - сортировка не нужна
+    if (stopsComboVersion == schedule->activeStopsVersion() && findStopCombo->count() > 0) {
+        return;
+    }
+    stopsComboVersion = schedule->activeStopsVersion();
     findStopCombo->clear();
 
     auto activeStops = schedule->getActiveStops();
@@ -93,7 +89,7 @@ void FindTransportDialog::updateStopsCombo() {
                       });
 
     for (const auto& stop : activeStops) {
-        findStopCombo->addItem(stop->getName());
+        findStopCombo->addItem(stop->getName(), QVariant::fromValue(stop->getId()));
     }
 
     if (findStopCombo->count() > 0) {
@@ -101,6 +97,14 @@ void FindTransportDialog::updateStopsCombo() {
     }
 }
 
+StopId FindTransportDialog::currentStopId() const {
+    auto data = findStopCombo->currentData();
+    if (!data.isValid()) {
+        return schedule->findStopId(findStopCombo->currentText());
+    }
+    return data.value<StopId>();
+}
+
 void FindTransportDialog::findNextTransport() {
     auto stopName = findStopCombo->currentText();
     if (stopName.isEmpty()) {
@@ -109,13 +113,14 @@ void FindTransportDialog::findNextTransport() {
     }
 
     try {
-        auto nextSchedules = schedule->findNextTransport(stopName);
-        nextTransportTable->setRowCount(nextSchedules.size());
+        auto stopId = currentStopId();
+        auto nextArrivals = schedule->findNextTransport(stopId);
+        nextTransportTable->setRowCount(nextArrivals.size());
 
         auto currentTime = schedule->getCurrentTime();
         auto currentDay = schedule->getCurrentDayOfWeek();
 
-        if (nextSchedules.isEmpty()) {
+        if (nextArrivals.isEmpty()) {
             QMessageBox::information(this, "Результат поиска",
                                      QString("На остановке \"%1\" нет транспорта в ближайшее время.\n\n"
                                              "Текущее время: %2\n"
@@ -126,24 +131,12 @@ void FindTransportDialog::findNextTransport() {
             return;
         }
 
-        // Исправлено: безопасный цикл с использованием нового метода
+        // Ближайший рейс и время ожидания уже рассчитаны расписанием
         int row = 0;
-        for (const auto& sched : nextSchedules) {
-            const auto& route = sched.getRoute();
-
-            auto arrivalTimeOpt = calculateArrivalTime(route, stopName);
-            if (!arrivalTimeOpt.has_value()) {
-                continue; // Пропускаем маршруты с ошибками
-            }
-
-            auto arrivalTime = arrivalTimeOpt.value();
-            auto currentTimeMinutes = currentTime.toMinutes();
-            auto arrivalTimeMinutes = arrivalTime.toMinutes();
-
-            auto waitMinutes = arrivalTimeMinutes - currentTimeMinutes;
-            if (waitMinutes < 0) {
-                waitMinutes += 24 * 60;
-            }
+        for (const auto& arrival : nextArrivals) {
+            const auto& route = arrival.schedule->getRoute();
+            const auto& arrivalTime = arrival.arrivalTime;
+            const auto waitMinutes = arrival.waitMinutes;
 
             QString waitTime;
             if (waitMinutes >= 60) {
@@ -158,7 +151,7 @@ void FindTransportDialog::findNextTransport() {
             nextTransportTable->setItem(row, 1, new QTableWidgetItem(route.getTransport().getType().getName()));
             nextTransportTable->setItem(row, 2, new QTableWidgetItem(arrivalTime.toString()));
             nextTransportTable->setItem(row, 3, new QTableWidgetItem(waitTime));
-            nextTransportTable->setItem(row, 4, new QTableWidgetItem(route.getEndStop()->getName()));
+            nextTransportTable->setItem(row, 4, new QTableWidgetItem(route.getEndStopName()));
 
             for (auto col = 0; col < 5; ++col) {
                 auto* item = nextTransportTable->item(row, col);
@@ -188,50 +181,33 @@ void FindTransportDialog::showAllRoutesForStop() {
         return;
     }
 
-    populateAllRoutesTable(stopName);
+    populateAllRoutesTable(currentStopId());
     tabWidget->setCurrentIndex(1);
 }
 
-void FindTransportDialog::populateAllRoutesTable(const QString& stopName) {
-    auto allSchedules = schedule->getAllSchedules();
-    QVector<Schedule> routesThroughStop;
-
-    for (const auto& scheduleItem : allSchedules) {
-        const auto& route = scheduleItem.getRoute();
-        bool passesThroughStop = false;
-
-        for (const auto& routeStop : route.getStops()) {
-            if (routeStop.stop->getName().compare(stopName, Qt::CaseInsensitive) == 0) {
-                passesThroughStop = true;
-                break;
-            }
-        }
-
-        if (passesThroughStop) {
-            routesThroughStop.push_back(scheduleItem);
-        }
-    }
+void FindTransportDialog::populateAllRoutesTable(StopId stopId) {
+    auto routesThroughStop = schedule->getSchedulesForStop(stopId);
 
     allRoutesTable->setRowCount(routesThroughStop.size());
 
     if (routesThroughStop.isEmpty()) {
         QMessageBox::information(this, "Все маршруты",
                                  QString("Через остановку \"%1\" не проходит ни один маршрут.")
-                                     .arg(stopName));
+                                     .arg(findStopCombo->currentText()));
         return;
     }
 
     // Исправлено: безопасный цикл с range-based for
     auto row = 0;
-    for (const auto& sched : routesThroughStop) {
-        const auto& route = sched.getRoute();
+    for (const auto* sched : routesThroughStop) {
+        const auto& route = sched->getRoute();
 
         allRoutesTable->setItem(row, 0, new QTableWidgetItem(QString::number(route.getRouteNumber())));
         allRoutesTable->setItem(row, 1, new QTableWidgetItem(route.getTransport().getType().getName()));
-        allRoutesTable->setItem(row, 2, new QTableWidgetItem(route.getStartStop()->getName()));
-        allRoutesTable->setItem(row, 3, new QTableWidgetItem(route.getEndStop()->getName()));
-        allRoutesTable->setItem(row, 4, new QTableWidgetItem(sched.getStartTime().toString()));
-        allRoutesTable->setItem(row, 5, new QTableWidgetItem(route.getDays().join(", ")));
+        allRoutesTable->setItem(row, 2, new QTableWidgetItem(route.getStartStopName()));
+        allRoutesTable->setItem(row, 3, new QTableWidgetItem(route.getEndStopName()));
+        allRoutesTable->setItem(row, 4, new QTableWidgetItem(ArrivalTimeService::formatTrips(*sched)));
+        allRoutesTable->setItem(row, 5, new QTableWidgetItem(route.getDays().toString()));
 
         for (auto col = 0; col < 6; ++col) {
             auto* item = allRoutesTable->item(row, col);
@@ -26,9 +26,8 @@ private slots:
 private:
     void setupUI();
     void updateStopsCombo();
-    void populateAllRoutesTable(const QString& stopName);
-
-    std::optional<TimeTransport> calculateArrivalTime(const Route& route, const QString& stopName);
+    void populateAllRoutesTable(StopId stopId);
+    StopId currentStopId() const;
 
     TransportSchedule* schedule;
     QComboBox* findStopCombo;
@@ -37,6 +36,8 @@ private:
     QPushButton* findButton;
     QPushButton* showAllRoutesButton;
     QTabWidget* tabWidget;
+    // activeStopsVersion() расписания на момент заполнения списка остановок
+    quint64 stopsComboVersion = 0;
 
 protected:
     void showEvent(QShowEvent* event) override;
@@ -0,0 +1,60 @@
+#include "FrequencyTrip.h"
+
+FrequencyTrip::FrequencyTrip(const TimeTransport& start, const TimeTransport& end, int headwayMinutes)
+    : startMinutes(start.toMinutes()), endMinutes(end.toMinutes()), headway(headwayMinutes) {}
+
+TimeTransport FrequencyTrip::getStart() const {
+    return TimeTransport(0, startMinutes);
+}
+
+TimeTransport FrequencyTrip::getEnd() const {
+    return TimeTransport(0, endMinutes);
+}
+
+int FrequencyTrip::getHeadway() const {
+    return headway;
+}
+
+bool FrequencyTrip::isValid() const {
+    return headway > 0 && startMinutes <= endMinutes;
+}
+
+int FrequencyTrip::getTripCount() const {
+    return isValid() ? (endMinutes - startMinutes) / headway + 1 : 0;
+}
+
+TimeTransport FrequencyTrip::getDeparture(int tripIndex) const {
+    return TimeTransport(0, startMinutes + tripIndex * headway);
+}
+
+std::optional<int> FrequencyTrip::firstTripAtOrAfter(int minutes) const {
+    if (!isValid() || minutes > endMinutes) {
+        return std::nullopt;
+    }
+    if (minutes <= startMinutes) {
+        return 0;
+    }
+
+    // Округляем вверх до ближайшего рейса
+    const int tripIndex = (minutes - startMinutes + headway - 1) / headway;
+    if (tripIndex >= getTripCount()) {
+        return std::nullopt;
+    }
+    return tripIndex;
+}
+
+QVector<TimeTransport> FrequencyTrip::expand() const {
+    QVector<TimeTransport> departures;
+    const int tripCount = getTripCount();
+    departures.reserve(tripCount);
+    for (int i = 0; i < tripCount; ++i) {
+        departures.push_back(getDeparture(i));
+    }
+    return departures;
+}
+
+QString FrequencyTrip::toString() const {
+    return QString("%1 – %2 каждые %3 мин")
+        .arg(getStart().toString(), getEnd().toString())
+        .arg(headway);
+}
@@ -0,0 +1,37 @@
+#ifndef FREQUENCYTRIP_H
+#define FREQUENCYTRIP_H
+
+#include <QString>
+#include <QVector>
+#include <optional>
+#include "TimeTransport.h"
+
+// Частотные рейсы "каждые N минут с start до end". Отправления не хранятся:
+// i-й рейс отправляется в start + i * headway, запросы считаются арифметически.
+class FrequencyTrip {
+public:
+    FrequencyTrip(const TimeTransport& start, const TimeTransport& end, int headwayMinutes);
+
+    TimeTransport getStart() const;
+    TimeTransport getEnd() const;
+    int getHeadway() const;
+    bool isValid() const;
+
+    int getTripCount() const;
+    TimeTransport getDeparture(int tripIndex) const;
+    // Индекс первого рейса, отправляющегося не раньше minutes (минуты от полуночи)
+    std::optional<int> firstTripAtOrAfter(int minutes) const;
+    // Явная материализация всех отправлений - только для экспорта
+    QVector<TimeTransport> expand() const;
+
+    QString toString() const;
+
+    bool operator==(const FrequencyTrip& other) const = default;
+
+private:
+    int startMinutes;
+    int endMinutes;
+    int headway;
+};
+
+#endif // FREQUENCYTRIP_H
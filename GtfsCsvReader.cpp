@@ -0,0 +1,182 @@
+#include "GtfsCsvReader.h"
+#include <algorithm>
+#include <cstring>
+
+GtfsCsvReader::GtfsCsvReader(const QString& filename) : file(filename) {}
+
+bool GtfsCsvReader::open(QString* errorMessage)
+{
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage)
+            *errorMessage = QString("Cannot open GTFS file: %1").arg(file.fileName());
+        return false;
+    }
+
+    buffer.resize(CHUNK_SIZE);
+    if (!readRow()) {
+        if (errorMessage)
+            *errorMessage = QString("GTFS file has no header: %1").arg(file.fileName());
+        return false;
+    }
+
+    header.clear();
+    for (std::string_view name : fields) {
+        // BOM в начале файла и пробелы вокруг имен колонок встречаются в реальных фидах
+        if (header.empty() && name.starts_with("\xEF\xBB\xBF"))
+            name.remove_prefix(3);
+        while (!name.empty() && name.front() == ' ')
+            name.remove_prefix(1);
+        while (!name.empty() && name.back() == ' ')
+            name.remove_suffix(1);
+        header.emplace_back(name);
+    }
+    return true;
+}
+
+int GtfsCsvReader::column(std::string_view name) const
+{
+    const auto it = std::ranges::find(header, name);
+    return it != header.end() ? static_cast<int>(it - header.begin()) : -1;
+}
+
+bool GtfsCsvReader::readRow()
+{
+    for (;;) {
+        qsizetype rowEnd = findRowEnd(position);
+        while (rowEnd < 0 && !endOfFile) {
+            if (!refill())
+                break;
+            rowEnd = findRowEnd(position);
+        }
+        if (rowEnd < 0) {
+            // Последняя строка без перевода строки
+            if (position >= available)
+                return false;
+            rowEnd = available;
+        }
+
+        const qsizetype begin = position;
+        position = std::min(rowEnd + 1, available);
+        consumed += position - begin;
+
+        qsizetype end = rowEnd;
+        if (end > begin && buffer[end - 1] == '\r')
+            --end;
+        if (end == begin)
+            continue;
+
+        splitRow(begin, end);
+        return true;
+    }
+}
+
+std::string_view GtfsCsvReader::field(int column) const
+{
+    if (column < 0 || column >= static_cast<int>(fields.size()))
+        return {};
+    return fields[column];
+}
+
+QByteArray GtfsCsvReader::fieldKey(int column) const
+{
+    const std::string_view value = field(column);
+    return QByteArray::fromRawData(value.data(), static_cast<qsizetype>(value.size()));
+}
+
+QByteArray GtfsCsvReader::fieldBytes(int column) const
+{
+    const std::string_view value = field(column);
+    return QByteArray(value.data(), static_cast<qsizetype>(value.size()));
+}
+
+QString GtfsCsvReader::fieldText(int column) const
+{
+    const std::string_view value = field(column);
+    return QString::fromUtf8(value.data(), static_cast<qsizetype>(value.size())).trimmed();
+}
+
+qint64 GtfsCsvReader::bytesRead() const
+{
+    return consumed;
+}
+
+qint64 GtfsCsvReader::totalBytes() const
+{
+    return file.size();
+}
+
+bool GtfsCsvReader::refill()
+{
+    // Недочитанный хвост переносится в начало буфера; строка длиннее буфера его увеличивает
+    const qsizetype tail = available - position;
+    if (position > 0 && tail > 0)
+        std::memmove(buffer.data(), buffer.constData() + position, tail);
+    position = 0;
+    available = tail;
+    if (available == buffer.size())
+        buffer.resize(buffer.size() * 2);
+
+    const qint64 read = file.read(buffer.data() + available, buffer.size() - available);
+    if (read <= 0) {
+        endOfFile = true;
+        return false;
+    }
+    available += read;
+    return true;
+}
+
+qsizetype GtfsCsvReader::findRowEnd(qsizetype from) const
+{
+    // Перевод строки внутри кавычек не завершает запись
+    const char* data = buffer.constData();
+    bool quoted = false;
+    for (qsizetype i = from; i < available; ++i) {
+        const char c = data[i];
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (c == '\n' && !quoted) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void GtfsCsvReader::splitRow(qsizetype begin, qsizetype end)
+{
+    fields.clear();
+    char* data = buffer.data();
+
+    qsizetype i = begin;
+    for (;;) {
+        if (i < end && data[i] == '"') {
+            // Поле в кавычках: "" внутри означает одну кавычку, сжимаем на месте
+            const qsizetype fieldBegin = i;
+            qsizetype out = i;
+            ++i;
+            while (i < end) {
+                if (data[i] == '"') {
+                    if (i + 1 < end && data[i + 1] == '"') {
+                        data[out++] = '"';
+                        i += 2;
+                        continue;
+                    }
+                    ++i;
+                    break;
+                }
+                data[out++] = data[i++];
+            }
+            fields.emplace_back(data + fieldBegin, out - fieldBegin);
+            while (i < end && data[i] != ',')
+                ++i;
+        } else {
+            const qsizetype fieldBegin = i;
+            while (i < end && data[i] != ',')
+                ++i;
+            fields.emplace_back(data + fieldBegin, i - fieldBegin);
+        }
+
+        if (i >= end)
+            break;
+        ++i; // ','
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef GTFSCSVREADER_H
+#define GTFSCSVREADER_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+#include <string_view>
+#include <vector>
+
+// Потоковое чтение CSV-файлов GTFS (RFC 4180): файл читается порциями
+// фиксированного размера, поля строки возвращаются как std::string_view
+// на внутренний буфер и действительны до следующего readRow().
+// Кавычки снимаются на месте, без выделения памяти на строку.
+class GtfsCsvReader
+{
+public:
+    static constexpr qsizetype CHUNK_SIZE = 1024 * 1024;
+
+    explicit GtfsCsvReader(const QString& filename);
+
+    // Открывает файл и читает строку заголовка
+    bool open(QString* errorMessage = nullptr);
+
+    // Индекс колонки по имени из заголовка или -1
+    int column(std::string_view name) const;
+
+    // Следующая непустая строка; false в конце файла
+    bool readRow();
+
+    // Пустое значение для отсутствующей колонки
+    std::string_view field(int column) const;
+    // Поле как ключ для поиска в QHash без копирования (действителен до следующей строки).
+    // Для вставки в хеш нужен fieldBytes: копирование QByteArray не копирует данные
+    QByteArray fieldKey(int column) const;
+    // Владеющая копия поля
+    QByteArray fieldBytes(int column) const;
+    QString fieldText(int column) const;
+
+    qint64 bytesRead() const;
+    qint64 totalBytes() const;
+
+private:
+    bool refill();
+    qsizetype findRowEnd(qsizetype from) const;
+    void splitRow(qsizetype begin, qsizetype end);
+
+    QFile file;
+    QByteArray buffer;
+    qsizetype position = 0;
+    qsizetype available = 0;
+    qint64 consumed = 0;
+    bool endOfFile = false;
+
+    std::vector<std::string> header;
+    std::vector<std::string_view> fields;
+};
+
+#endif // GTFSCSVREADER_H
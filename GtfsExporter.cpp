@@ -0,0 +1,283 @@
+#include "GtfsExporter.h"
+#include "CoordinateService.h"
+#include <QDir>
+#include <QDate>
+#include <QSet>
+#include <QDebug>
+#include <QtConcurrent>
+#include <charconv>
+#include <numeric>
+
+GtfsExporter::GtfsExporter(QObject *parent) : QObject(parent) {}
+
+bool GtfsExporter::exportFeed(const QString& directory, const QVector<Schedule>& schedules,
+                              const QVector<QSharedPointer<Stop>>& allStops, QString* errorMessage)
+{
+    if (!QDir().mkpath(directory)) {
+        if (errorMessage)
+            *errorMessage = QString("Cannot create directory: %1").arg(directory);
+        return false;
+    }
+
+    if (!writeStops(directory, allStops, errorMessage)
+        || !writeRoutes(directory, schedules, errorMessage)
+        || !writeCalendar(directory, schedules, errorMessage)
+        || !writeTrips(directory, schedules, errorMessage)) {
+        return false;
+    }
+
+    qDebug() << "Exported" << schedules.size() << "schedules to GTFS feed" << directory;
+    return true;
+}
+
+bool GtfsExporter::writeStops(const QString& directory, const QVector<QSharedPointer<Stop>>& allStops,
+                              QString* errorMessage) const
+{
+    QSaveFile file(QDir(directory).filePath("stops.txt"));
+    if (!openFile(file, errorMessage))
+        return false;
+
+    QByteArray out("stop_id,stop_name,stop_lat,stop_lon\n");
+    for (const auto& stop : allStops) {
+        const auto coordinate = CoordinateService::parseCoordinate(stop->getCoordinate());
+        appendInt(out, stop->getId());
+        out += ',';
+        out += csvField(stop->getName());
+        out += ',';
+        if (coordinate.isValid) {
+            out += QByteArray::number(coordinate.latitude, 'f', 6);
+            out += ',';
+            out += QByteArray::number(coordinate.longitude, 'f', 6);
+        } else {
+            out += ',';
+        }
+        out += '\n';
+    }
+
+    file.write(out);
+    return commitFile(file, errorMessage);
+}
+
+bool GtfsExporter::writeRoutes(const QString& directory, const QVector<Schedule>& schedules, QString* errorMessage) const
+{
+    QSaveFile file(QDir(directory).filePath("routes.txt"));
+    if (!openFile(file, errorMessage))
+        return false;
+
+    // Шаблоны одного маршрута выгружаются как один route с несколькими trips
+    QByteArray out("route_id,route_short_name,route_long_name,route_type\n");
+    QSet<QByteArray> written;
+    for (const auto& schedule : schedules) {
+        const QByteArray id = routeId(schedule);
+        if (written.contains(id))
+            continue;
+        written.insert(id);
+
+        const auto& transport = schedule.getRoute().getTransport();
+        out += id;
+        out += ',';
+        appendInt(out, transport.getId());
+        out += ',';
+        out += csvField(transport.getFullName());
+        out += ',';
+        appendInt(out, gtfsRouteType(transport.getType()));
+        out += '\n';
+    }
+
+    file.write(out);
+    return commitFile(file, errorMessage);
+}
+
+bool GtfsExporter::writeCalendar(const QString& directory, const QVector<Schedule>& schedules,
+                                 QString* errorMessage) const
+{
+    QSaveFile file(QDir(directory).filePath("calendar.txt"));
+    if (!openFile(file, errorMessage))
+        return false;
+
+    // Расписание недельное, поэтому сервис действует год с сегодняшнего дня
+    const QDate today = QDate::currentDate();
+    const QByteArray startDate = today.toString("yyyyMMdd").toLatin1();
+    const QByteArray endDate = today.addYears(1).toString("yyyyMMdd").toLatin1();
+
+    QByteArray out("service_id,monday,tuesday,wednesday,thursday,friday,saturday,sunday,start_date,end_date\n");
+    QSet<std::uint8_t> written;
+    for (const auto& schedule : schedules) {
+        const DayMask days = schedule.getRoute().getDays();
+        if (written.contains(days.toBits()))
+            continue;
+        written.insert(days.toBits());
+
+        out += serviceId(days);
+        for (int day = 1; day <= DayMask::DAYS_IN_WEEK; ++day) {
+            out += days.contains(day) ? ",1" : ",0";
+        }
+        out += ',';
+        out += startDate;
+        out += ',';
+        out += endDate;
+        out += '\n';
+    }
+
+    file.write(out);
+    return commitFile(file, errorMessage);
+}
+
+bool GtfsExporter::writeTrips(const QString& directory, const QVector<Schedule>& schedules, QString* errorMessage)
+{
+    QSaveFile tripsFile(QDir(directory).filePath("trips.txt"));
+    QSaveFile stopTimesFile(QDir(directory).filePath("stop_times.txt"));
+    if (!openFile(tripsFile, errorMessage) || !openFile(stopTimesFile, errorMessage))
+        return false;
+
+    tripsFile.write("route_id,service_id,trip_id\n");
+    stopTimesFile.write("trip_id,arrival_time,departure_time,stop_id,stop_sequence\n");
+
+    // Порция расписаний форматируется параллельно, затем блоки пишутся по порядку:
+    // в памяти одновременно находится не больше BATCH_SIZE готовых блоков
+    for (int batchStart = 0; batchStart < schedules.size(); batchStart += BATCH_SIZE) {
+        QVector<int> indices(std::min<int>(BATCH_SIZE, schedules.size() - batchStart));
+        std::iota(indices.begin(), indices.end(), batchStart);
+
+        const auto blocks = QtConcurrent::blockingMapped<QVector<ScheduleBlock>>(indices, [&schedules](int index) {
+            return formatSchedule(index, schedules[index]);
+        });
+
+        for (const auto& block : blocks) {
+            if (tripsFile.write(block.trips) != block.trips.size()
+                || stopTimesFile.write(block.stopTimes) != block.stopTimes.size()) {
+                if (errorMessage)
+                    *errorMessage = QString("Cannot write GTFS trips: %1").arg(stopTimesFile.errorString());
+                return false;
+            }
+        }
+
+        emit progressChanged(static_cast<int>((batchStart + indices.size()) * 100LL / schedules.size()));
+    }
+
+    return commitFile(tripsFile, errorMessage) && commitFile(stopTimesFile, errorMessage);
+}
+
+GtfsExporter::ScheduleBlock GtfsExporter::formatSchedule(int scheduleIndex, const Schedule& schedule)
+{
+    ScheduleBlock block;
+    const Route& route = schedule.getRoute();
+    const auto stops = route.getStops();
+    const auto offsets = route.getOffsets();
+    const QByteArray routeKey = routeId(schedule);
+    const QByteArray serviceKey = serviceId(route.getDays());
+
+    // Частотные рейсы разворачиваются: потребителю нужен каждый рейс
+    const QVector<TimeTransport> departures = schedule.expandDepartures();
+    block.stopTimes.reserve(departures.size() * static_cast<qsizetype>(stops.size()) * 40);
+
+    QByteArray tripId;
+    for (int trip = 0; trip < departures.size(); ++trip) {
+        tripId.clear();
+        appendInt(tripId, scheduleIndex);
+        tripId += '_';
+        appendInt(tripId, trip);
+
+        block.trips += routeKey;
+        block.trips += ',';
+        block.trips += serviceKey;
+        block.trips += ',';
+        block.trips += tripId;
+        block.trips += '\n';
+
+        // Время после полуночи записывается как 24:xx и далее, как требует GTFS
+        const int start = departures[trip].toMinutes();
+        for (std::size_t stop = 0; stop < stops.size(); ++stop) {
+            const int minutes = start + offsets[stop];
+            block.stopTimes += tripId;
+            block.stopTimes += ',';
+            appendTime(block.stopTimes, minutes);
+            block.stopTimes += ',';
+            appendTime(block.stopTimes, minutes);
+            block.stopTimes += ',';
+            appendInt(block.stopTimes, stops[stop].stopId);
+            block.stopTimes += ',';
+            appendInt(block.stopTimes, static_cast<long long>(stop) + 1);
+            block.stopTimes += '\n';
+        }
+    }
+    return block;
+}
+
+QByteArray GtfsExporter::routeId(const Schedule& schedule)
+{
+    const auto& transport = schedule.getRoute().getTransport();
+    QByteArray id;
+    appendInt(id, transport.getType().getId());
+    id += '_';
+    appendInt(id, transport.getId());
+    return id;
+}
+
+QByteArray GtfsExporter::serviceId(DayMask days)
+{
+    QByteArray id("days_");
+    appendInt(id, days.toBits());
+    return id;
+}
+
+int GtfsExporter::gtfsRouteType(const TransportType& type)
+{
+    switch (type.getType()) {
+    case TransportType::Type::TRAM: return 0;
+    case TransportType::Type::TROLLEYBUS: return 11;
+    case TransportType::Type::BUS:
+    default: return 3;
+    }
+}
+
+QByteArray GtfsExporter::csvField(const QString& value)
+{
+    QByteArray utf8 = value.toUtf8();
+    if (!utf8.contains(',') && !utf8.contains('"') && !utf8.contains('\n'))
+        return utf8;
+    QByteArray quoted("\"");
+    quoted += utf8.replace("\"", "\"\"");
+    quoted += '"';
+    return quoted;
+}
+
+void GtfsExporter::appendInt(QByteArray& out, long long value)
+{
+    char digits[24];
+    const auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, end - digits);
+}
+
+void GtfsExporter::appendTime(QByteArray& out, int minutes)
+{
+    const int hours = minutes / 60;
+    const int minute = minutes % 60;
+    if (hours < 10)
+        out += '0';
+    appendInt(out, hours);
+    out += ':';
+    out += static_cast<char>('0' + minute / 10);
+    out += static_cast<char>('0' + minute % 10);
+    out += ":00";
+}
+
+bool GtfsExporter::openFile(QSaveFile& file, QString* errorMessage)
+{
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorMessage)
+            *errorMessage = QString("Cannot open file for writing: %1").arg(file.fileName());
+        return false;
+    }
+    return true;
+}
+
+bool GtfsExporter::commitFile(QSaveFile& file, QString* errorMessage)
+{
+    if (!file.commit()) {
+        if (errorMessage)
+            *errorMessage = QString("Cannot commit file: %1").arg(file.fileName());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef GTFSEXPORTER_H
+#define GTFSEXPORTER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QSaveFile>
+#include <QVector>
+#include <QSharedPointer>
+#include "Schedule.h"
+#include "Stop.h"
+#include "TransportType.h"
+
+// Выгрузка расписания в формате GTFS (stops.txt, routes.txt, trips.txt,
+// stop_times.txt, calendar.txt). Каждый рейс шаблона, включая развернутые
+// частотные, становится отдельным trip; время на остановках вычисляется из
+// времени отправления и смещений маршрута. Блоки trips/stop_times формируются
+// параллельно порциями расписаний и записываются в файлы последовательно.
+class GtfsExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GtfsExporter(QObject *parent = nullptr);
+
+    bool exportFeed(const QString& directory, const QVector<Schedule>& schedules,
+                    const QVector<QSharedPointer<Stop>>& allStops, QString* errorMessage = nullptr);
+
+signals:
+    // Процент выгруженных расписаний
+    void progressChanged(int percent);
+
+private:
+    // Готовые строки trips.txt и stop_times.txt одного расписания
+    struct ScheduleBlock {
+        QByteArray trips;
+        QByteArray stopTimes;
+    };
+
+    bool writeStops(const QString& directory, const QVector<QSharedPointer<Stop>>& allStops, QString* errorMessage) const;
+    bool writeRoutes(const QString& directory, const QVector<Schedule>& schedules, QString* errorMessage) const;
+    bool writeCalendar(const QString& directory, const QVector<Schedule>& schedules, QString* errorMessage) const;
+    bool writeTrips(const QString& directory, const QVector<Schedule>& schedules, QString* errorMessage);
+
+    static ScheduleBlock formatSchedule(int scheduleIndex, const Schedule& schedule);
+
+    static QByteArray routeId(const Schedule& schedule);
+    static QByteArray serviceId(DayMask days);
+    static int gtfsRouteType(const TransportType& type);
+    static QByteArray csvField(const QString& value);
+    static void appendInt(QByteArray& out, long long value);
+    static void appendTime(QByteArray& out, int minutes);
+
+    static bool openFile(QSaveFile& file, QString* errorMessage);
+    static bool commitFile(QSaveFile& file, QString* errorMessage);
+
+    // Число расписаний, форматируемых параллельно между записями на диск
+    static constexpr int BATCH_SIZE = 256;
+};
+
+#endif // GTFSEXPORTER_H
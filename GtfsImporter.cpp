@@ -0,0 +1,442 @@
+#include "GtfsImporter.h"
+#include "GtfsCsvReader.h"
+#include "CoordinateService.h"
+#include "ValidationService.h"
+#include "ArrivalTimeService.h"
+#include <QDir>
+#include <QDebug>
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+namespace {
+constexpr int PROGRESS_ROW_INTERVAL = 64 * 1024;
+
+std::optional<int> parseInt(std::string_view text)
+{
+    while (!text.empty() && text.front() == ' ')
+        text.remove_prefix(1);
+    while (!text.empty() && text.back() == ' ')
+        text.remove_suffix(1);
+
+    int value = 0;
+    const char* end = text.data() + text.size();
+    const auto [ptr, ec] = std::from_chars(text.data(), end, value);
+    if (text.empty() || ec != std::errc() || ptr != end)
+        return std::nullopt;
+    return value;
+}
+
+std::optional<double> parseDouble(const QString& text)
+{
+    bool ok = false;
+    const double value = text.toDouble(&ok);
+    return ok ? std::optional<double>(value) : std::nullopt;
+}
+}
+
+GtfsImporter::GtfsImporter(QObject *parent) : QObject(parent) {}
+
+GtfsImporter::ImportResult GtfsImporter::importFeed(const QString& directory, const StopResolver& resolveStops)
+{
+    ImportResult result;
+    resolver = resolveStops;
+
+    // stop_times.txt ссылается на все остальные файлы, поэтому читается последним
+    if (!readCalendar(directory, &result.errorMessage)
+        || !readRoutes(directory, &result.errorMessage)
+        || !readTrips(directory, &result.errorMessage)
+        || !readStops(directory, &result.errorMessage)
+        || !readFrequencies(directory, &result.errorMessage)
+        || !readStopTimes(directory, &result.errorMessage)) {
+        return result;
+    }
+
+    result.schedules.reserve(patterns.size());
+    for (auto& pattern : patterns) {
+        Schedule schedule(pattern.route, pattern.departures);
+        schedule.setFrequencies(pattern.frequencies);
+        result.schedules.push_back(schedule);
+    }
+    result.tripCount = tripCount;
+    result.skippedTrips = skippedTrips;
+    result.success = true;
+
+    qDebug() << "Imported GTFS feed" << directory << ":" << tripCount << "trips in"
+             << result.schedules.size() << "trip patterns," << skippedTrips << "trips skipped";
+    return result;
+}
+
+bool GtfsImporter::readCalendar(const QString& directory, QString* errorMessage)
+{
+    // Без calendar.txt (фид только с calendar_dates.txt) маршруты считаются ежедневными
+    const QString path = QDir(directory).filePath("calendar.txt");
+    if (!QFile::exists(path))
+        return true;
+
+    GtfsCsvReader reader(path);
+    if (!reader.open(errorMessage))
+        return false;
+
+    const int serviceColumn = reader.column("service_id");
+    static constexpr std::string_view dayColumns[DayMask::DAYS_IN_WEEK] = {
+        "monday", "tuesday", "wednesday", "thursday", "friday", "saturday", "sunday"};
+    int columns[DayMask::DAYS_IN_WEEK];
+    for (int day = 0; day < DayMask::DAYS_IN_WEEK; ++day) {
+        columns[day] = reader.column(dayColumns[day]);
+    }
+    if (serviceColumn < 0) {
+        *errorMessage = "calendar.txt: service_id column not found";
+        return false;
+    }
+
+    while (reader.readRow()) {
+        DayMask days;
+        for (int day = 0; day < DayMask::DAYS_IN_WEEK; ++day) {
+            if (reader.field(columns[day]) == "1")
+                days = days | DayMask::fromDayOfWeek(day + 1);
+        }
+        services.insert(reader.fieldBytes(serviceColumn), days);
+    }
+    return true;
+}
+
+bool GtfsImporter::readRoutes(const QString& directory, QString* errorMessage)
+{
+    GtfsCsvReader reader(QDir(directory).filePath("routes.txt"));
+    if (!reader.open(errorMessage))
+        return false;
+
+    const int idColumn = reader.column("route_id");
+    const int shortNameColumn = reader.column("route_short_name");
+    const int typeColumn = reader.column("route_type");
+    if (idColumn < 0 || typeColumn < 0) {
+        *errorMessage = "routes.txt: route_id or route_type column not found";
+        return false;
+    }
+
+    int unsupported = 0;
+    while (reader.readRow()) {
+        const auto routeType = parseInt(reader.field(typeColumn));
+        const auto transportType = routeType ? transportTypeFromGtfs(*routeType) : std::nullopt;
+        const auto routeNumber = routeNumberFromName(reader.fieldText(shortNameColumn));
+        if (!transportType || !routeNumber) {
+            ++unsupported;
+            continue;
+        }
+
+        routeIndexById.insert(reader.fieldBytes(idColumn), routes.size());
+        routes.push_back(GtfsRoute{Transport(*transportType, *routeNumber)});
+    }
+
+    if (unsupported > 0)
+        qDebug() << "Skipping" << unsupported << "GTFS routes with unsupported type or number";
+    return true;
+}
+
+bool GtfsImporter::readTrips(const QString& directory, QString* errorMessage)
+{
+    GtfsCsvReader reader(QDir(directory).filePath("trips.txt"));
+    if (!reader.open(errorMessage))
+        return false;
+
+    const int tripColumn = reader.column("trip_id");
+    const int routeColumn = reader.column("route_id");
+    const int serviceColumn = reader.column("service_id");
+    if (tripColumn < 0 || routeColumn < 0) {
+        *errorMessage = "trips.txt: trip_id or route_id column not found";
+        return false;
+    }
+
+    while (reader.readRow()) {
+        const int routeIndex = routeIndexById.value(reader.fieldKey(routeColumn), -1);
+        if (routeIndex < 0)
+            continue;
+
+        const DayMask days = services.value(reader.fieldKey(serviceColumn), DayMask(DayMask::ALL_DAYS));
+        if (days.isEmpty())
+            continue;
+        trips.insert(reader.fieldBytes(tripColumn), GtfsTrip{routeIndex, days});
+    }
+    return true;
+}
+
+bool GtfsImporter::readStops(const QString& directory, QString* errorMessage)
+{
+    GtfsCsvReader reader(QDir(directory).filePath("stops.txt"));
+    if (!reader.open(errorMessage))
+        return false;
+
+    const int idColumn = reader.column("stop_id");
+    const int nameColumn = reader.column("stop_name");
+    const int latColumn = reader.column("stop_lat");
+    const int lonColumn = reader.column("stop_lon");
+    const int locationTypeColumn = reader.column("location_type");
+    if (idColumn < 0 || nameColumn < 0) {
+        *errorMessage = "stops.txt: stop_id or stop_name column not found";
+        return false;
+    }
+
+    // Остановки разрешаются лениво: в расписание попадают только те, через которые идут рейсы
+    while (reader.readRow()) {
+        const std::string_view locationType = reader.field(locationTypeColumn);
+        if (!locationType.empty() && locationType != "0")
+            continue;
+
+        QString coordinate;
+        const auto lat = parseDouble(reader.fieldText(latColumn));
+        const auto lon = parseDouble(reader.fieldText(lonColumn));
+        if (lat && lon)
+            coordinate = CoordinateService::formatCoordinate(CoordinateService::Coordinate(*lat, *lon, true));
+
+        stopIndexById.insert(reader.fieldBytes(idColumn), stops.size());
+        stops.push_back(GtfsStop{reader.fieldText(nameColumn), coordinate});
+    }
+    return true;
+}
+
+bool GtfsImporter::readFrequencies(const QString& directory, QString* errorMessage)
+{
+    const QString path = QDir(directory).filePath("frequencies.txt");
+    if (!QFile::exists(path))
+        return true;
+
+    GtfsCsvReader reader(path);
+    if (!reader.open(errorMessage))
+        return false;
+
+    const int tripColumn = reader.column("trip_id");
+    const int startColumn = reader.column("start_time");
+    const int endColumn = reader.column("end_time");
+    const int headwayColumn = reader.column("headway_secs");
+
+    while (reader.readRow()) {
+        const auto start = parseTime(reader.field(startColumn));
+        const auto end = parseTime(reader.field(endColumn));
+        const auto headwaySeconds = parseInt(reader.field(headwayColumn));
+        if (!start || !end || !headwaySeconds)
+            continue;
+
+        // В GTFS end_time не включается, у FrequencyTrip окончание включительно
+        FrequencyTrip frequency(TimeTransport(0, *start % ArrivalTimeService::MINUTES_IN_DAY),
+                                TimeTransport(0, (*end - 1) % ArrivalTimeService::MINUTES_IN_DAY),
+                                std::max(1, *headwaySeconds / 60));
+        if (frequency.isValid())
+            frequenciesByTrip[reader.fieldBytes(tripColumn)].push_back(frequency);
+    }
+    return true;
+}
+
+bool GtfsImporter::readStopTimes(const QString& directory, QString* errorMessage)
+{
+    GtfsCsvReader reader(QDir(directory).filePath("stop_times.txt"));
+    if (!reader.open(errorMessage))
+        return false;
+
+    const int tripColumn = reader.column("trip_id");
+    const int arrivalColumn = reader.column("arrival_time");
+    const int departureColumn = reader.column("departure_time");
+    const int stopColumn = reader.column("stop_id");
+    const int sequenceColumn = reader.column("stop_sequence");
+    if (tripColumn < 0 || stopColumn < 0 || sequenceColumn < 0) {
+        *errorMessage = "stop_times.txt: trip_id, stop_id or stop_sequence column not found";
+        return false;
+    }
+
+    const qint64 totalBytes = std::max<qint64>(1, reader.totalBytes());
+    int lastPercent = -1;
+    qint64 rows = 0;
+
+    QByteArray currentTrip;
+    QVector<StopTime> stopTimes;
+    while (reader.readRow()) {
+        const QByteArray tripId = reader.fieldKey(tripColumn);
+        if (tripId != currentTrip) {
+            finishTrip(currentTrip, stopTimes);
+            currentTrip = reader.fieldBytes(tripColumn);
+        }
+
+        // Пустое время у промежуточной остановки интерполируется при завершении рейса
+        std::optional<int> minutes = parseTime(reader.field(departureColumn));
+        if (!minutes)
+            minutes = parseTime(reader.field(arrivalColumn));
+        stopTimes.push_back(StopTime{parseInt(reader.field(sequenceColumn)).value_or(0),
+                                     stopIndexById.value(reader.fieldKey(stopColumn), -1),
+                                     minutes.value_or(-1)});
+
+        if (++rows % PROGRESS_ROW_INTERVAL == 0) {
+            const int percent = static_cast<int>(reader.bytesRead() * 100 / totalBytes);
+            if (percent != lastPercent) {
+                lastPercent = percent;
+                emit progressChanged(percent);
+            }
+        }
+    }
+    finishTrip(currentTrip, stopTimes);
+    emit progressChanged(100);
+    return true;
+}
+
+void GtfsImporter::finishTrip(const QByteArray& tripId, QVector<StopTime>& stopTimes)
+{
+    if (stopTimes.isEmpty())
+        return;
+
+    auto skip = [this, &stopTimes]() {
+        ++skippedTrips;
+        stopTimes.clear();
+    };
+
+    auto trip = trips.find(tripId);
+    if (trip == trips.end()) {
+        skip();
+        return;
+    }
+    if (trip->imported) {
+        qDebug() << "stop_times.txt is not grouped by trip_id, skipping fragment of trip" << tripId;
+        skip();
+        return;
+    }
+    trip->imported = true;
+
+    std::ranges::sort(stopTimes, {}, &StopTime::sequence);
+    if (stopTimes.size() < 2 || stopTimes.first().minutes < 0 || stopTimes.last().minutes < 0) {
+        skip();
+        return;
+    }
+
+    // Линейная интерполяция времени для остановок без расписания (не контрольных точек)
+    int previous = 0;
+    for (int i = 1; i < stopTimes.size(); ++i) {
+        if (stopTimes[i].minutes < 0)
+            continue;
+        for (int j = previous + 1; j < i; ++j) {
+            stopTimes[j].minutes = stopTimes[previous].minutes
+                + (stopTimes[i].minutes - stopTimes[previous].minutes) * (j - previous) / (i - previous);
+        }
+        previous = i;
+    }
+
+    QVector<StopId> stopIds;
+    stopIds.reserve(stopTimes.size());
+    for (const auto& stopTime : stopTimes) {
+        const auto stopId = resolveStop(stopTime.stopIndex);
+        if (!stopId) {
+            skip();
+            return;
+        }
+        stopIds.push_back(*stopId);
+    }
+
+    QVector<int> travelTimes;
+    travelTimes.reserve(stopTimes.size() - 1);
+    for (int i = 0; i + 1 < stopTimes.size(); ++i) {
+        travelTimes.push_back(std::clamp(stopTimes[i + 1].minutes - stopTimes[i].minutes,
+                                         ValidationService::MIN_TRAVEL_TIME, ValidationService::MAX_TRAVEL_TIME));
+    }
+
+    // Ключ шаблона: маршрут, дни, остановки и времена движения
+    QByteArray key;
+    key.reserve(static_cast<qsizetype>(sizeof(int) * (2 + stopIds.size() + travelTimes.size())));
+    const int header[2] = {trip->routeIndex, trip->days.toBits()};
+    key.append(reinterpret_cast<const char*>(header), sizeof(header));
+    key.append(reinterpret_cast<const char*>(stopIds.constData()), stopIds.size() * sizeof(StopId));
+    key.append(reinterpret_cast<const char*>(travelTimes.constData()), travelTimes.size() * sizeof(int));
+
+    int patternIndex = patternIndexByKey.value(key, -1);
+    if (patternIndex < 0) {
+        Route route(routes[trip->routeIndex].transport, stopIds.first(), stopIds.last());
+        route.setDays(trip->days);
+        for (int i = 1; i + 1 < stopIds.size(); ++i) {
+            route.addStop(stopIds[i], travelTimes[i - 1]);
+        }
+        route.addFinalTravelTime(travelTimes.last());
+
+        patternIndex = patterns.size();
+        patternIndexByKey.insert(key, patternIndex);
+        patterns.push_back(Pattern{route, {}, {}});
+    }
+
+    // Рейсы из frequencies.txt задают интервалы, stop_times - только шаблон
+    Pattern& pattern = patterns[patternIndex];
+    const auto frequencies = frequenciesByTrip.constFind(tripId);
+    if (frequencies != frequenciesByTrip.constEnd()) {
+        pattern.frequencies += *frequencies;
+    } else {
+        pattern.departures.push_back(TimeTransport(0, stopTimes.first().minutes % ArrivalTimeService::MINUTES_IN_DAY));
+    }
+
+    ++tripCount;
+    stopTimes.clear();
+}
+
+std::optional<StopId> GtfsImporter::resolveStop(int stopIndex)
+{
+    if (stopIndex < 0)
+        return std::nullopt;
+
+    GtfsStop& stop = stops[stopIndex];
+    if (stop.id == StopRegistry::INVALID_ID) {
+        try {
+            const auto resolved = resolver({stop.name}, {stop.coordinate});
+            if (resolved.isEmpty())
+                return std::nullopt;
+            stop.id = resolved.first()->getId();
+        } catch (const std::runtime_error& e) {
+            qDebug() << "Skipping GTFS stop" << stop.name << ":" << e.what();
+            return std::nullopt;
+        }
+    }
+    return stop.id;
+}
+
+std::optional<int> GtfsImporter::parseTime(std::string_view text)
+{
+    // "H:MM:SS" или "HH:MM:SS"; секунды отбрасываются
+    const auto firstColon = text.find(':');
+    if (firstColon == std::string_view::npos)
+        return std::nullopt;
+    const auto secondColon = text.find(':', firstColon + 1);
+
+    const auto hours = parseInt(text.substr(0, firstColon));
+    const auto minutes = parseInt(text.substr(firstColon + 1, secondColon - firstColon - 1));
+    if (!hours || !minutes || *hours < 0 || *minutes < 0 || *minutes >= TimeTransport::MINUTES_PER_HOUR)
+        return std::nullopt;
+    return *hours * TimeTransport::MINUTES_PER_HOUR + *minutes;
+}
+
+std::optional<TransportType> GtfsImporter::transportTypeFromGtfs(int routeType)
+{
+    // Базовые и расширенные (Google Transit) коды route_type
+    switch (routeType) {
+    case 0:
+    case 900:
+        return TransportType(TransportType::Type::TRAM);
+    case 3:
+    case 700:
+    case 702:
+    case 704:
+        return TransportType(TransportType::Type::BUS);
+    case 11:
+    case 800:
+        return TransportType(TransportType::Type::TROLLEYBUS);
+    default:
+        return std::nullopt;
+    }
+}
+
+std::optional<int> GtfsImporter::routeNumberFromName(const QString& shortName)
+{
+    // Номер маршрута - целое; буквенные префиксы и суффиксы ("М1", "12к") отбрасываются
+    QString digits;
+    for (const QChar c : shortName) {
+        if (c.isDigit())
+            digits += c;
+        else if (!digits.isEmpty())
+            break;
+    }
+
+    bool ok = false;
+    const int number = digits.toInt(&ok);
+    return ok && number > 0 ? std::optional<int>(number) : std::nullopt;
+}
@@ -0,0 +1,105 @@
+#ifndef GTFSIMPORTER_H
+#define GTFSIMPORTER_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QSharedPointer>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include "Schedule.h"
+#include "Stop.h"
+#include "DayMask.h"
+#include "Transport.h"
+
+class GtfsCsvReader;
+
+// Импорт распакованного фида GTFS (stops.txt, routes.txt, trips.txt,
+// stop_times.txt, calendar.txt, необязательный frequencies.txt).
+// stop_times.txt читается потоком: в памяти держатся только строки текущего
+// рейса, поэтому файл должен быть сгруппирован по trip_id, как принято в фидах.
+// Рейсы с одинаковой последовательностью остановок, временами движения и днями
+// объединяются в один шаблон маршрута (Schedule).
+class GtfsImporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    using StopResolver = std::function<QVector<QSharedPointer<Stop>>(const QStringList&, const QStringList&)>;
+
+    struct ImportResult {
+        QVector<Schedule> schedules;
+        int tripCount = 0;
+        int skippedTrips = 0;
+        bool success = false;
+        QString errorMessage;
+    };
+
+    explicit GtfsImporter(QObject *parent = nullptr);
+
+    ImportResult importFeed(const QString& directory, const StopResolver& resolveStops);
+
+signals:
+    // Процент прочитанного stop_times.txt
+    void progressChanged(int percent);
+
+private:
+    struct GtfsRoute {
+        Transport transport;
+    };
+
+    struct GtfsTrip {
+        int routeIndex;
+        DayMask days;
+        bool imported = false;
+    };
+
+    struct GtfsStop {
+        QString name;
+        QString coordinate;
+        StopId id = StopRegistry::INVALID_ID;
+    };
+
+    struct StopTime {
+        int sequence;
+        int stopIndex;
+        int minutes;
+    };
+
+    struct Pattern {
+        Route route;
+        QVector<TimeTransport> departures;
+        QVector<FrequencyTrip> frequencies;
+    };
+
+    bool readCalendar(const QString& directory, QString* errorMessage);
+    bool readRoutes(const QString& directory, QString* errorMessage);
+    bool readTrips(const QString& directory, QString* errorMessage);
+    bool readStops(const QString& directory, QString* errorMessage);
+    bool readFrequencies(const QString& directory, QString* errorMessage);
+    bool readStopTimes(const QString& directory, QString* errorMessage);
+
+    void finishTrip(const QByteArray& tripId, QVector<StopTime>& stopTimes);
+    std::optional<StopId> resolveStop(int stopIndex);
+
+    // "HH:MM:SS" в минутах от начала суток; часы могут быть больше 24
+    static std::optional<int> parseTime(std::string_view text);
+    static std::optional<TransportType> transportTypeFromGtfs(int routeType);
+    static std::optional<int> routeNumberFromName(const QString& shortName);
+
+    StopResolver resolver;
+    QHash<QByteArray, DayMask> services;
+    QHash<QByteArray, int> routeIndexById;
+    QVector<GtfsRoute> routes;
+    QHash<QByteArray, GtfsTrip> trips;
+    QHash<QByteArray, int> stopIndexById;
+    QVector<GtfsStop> stops;
+    QHash<QByteArray, QVector<FrequencyTrip>> frequenciesByTrip;
+    QHash<QByteArray, int> patternIndexByKey;
+    QVector<Pattern> patterns;
+    int tripCount = 0;
+    int skippedTrips = 0;
+};
+
+#endif // GTFSIMPORTER_H
@@ -1,94 +1,128 @@
 #include "Route.h"
-#include <QDebug>
+#include <algorithm>
 
-RouteStop::RouteStop(QSharedPointer<Stop> stop, const TimeTransport& time)
-    : stop(stop), arrivalTime(time) {}
+RouteStop::RouteStop(StopId stopId)
+    : stopId(stopId) {}
 
 QString RouteStop::getName() const {
-    return stop->getName();
+    return StopRegistry::instance().name(stopId);
 }
 
-Route::Route(const Transport& transport, QSharedPointer<Stop> start, QSharedPointer<Stop> end)
+Route::Route(const Transport& transport, StopId start, StopId end)
     : transport(transport), startStop(start), endStop(end) {
-    stops.push_back(RouteStop(start, TimeTransport(0, 0)));
+    stops.push_back(RouteStop(start));
+    offsets.push_back(0);
 }
 
-void Route::addStop(QSharedPointer<Stop> stop, int travelTimeFromPrevious) {
-    if (!stop) {
+void Route::addStop(StopId stopId, int travelTimeFromPrevious) {
+    if (stopId == StopRegistry::INVALID_ID) {
         throw InvalidRouteConfigurationException("Попытка добавить пустую остановку");
     }
 
-    stops.push_back(RouteStop(stop, TimeTransport(0, 0)));
+    stops.push_back(RouteStop(stopId));
     travelTimes.push_back(travelTimeFromPrevious);
+    offsets.push_back(offsets.last() + travelTimeFromPrevious);
 }
 
 void Route::addFinalTravelTime(int travelTime) {
-    stops.push_back(RouteStop(endStop, TimeTransport(0, 0)));
+    stops.push_back(RouteStop(endStop));
     travelTimes.push_back(travelTime);
+    offsets.push_back(offsets.last() + travelTime);
 }
 
-void Route::calculateArrivalTimes(const TimeTransport& startTime) {
-    if (stops.empty() || travelTimes.empty()) {
-        throw InvalidRouteConfigurationException("Недостаточно данных для расчета времени прибытия");
+int Route::getOffsetAtStop(int stopIndex) const {
+    if (stopIndex < 0 || stopIndex >= offsets.size()) {
+        throw InvalidRouteConfigurationException(QString("Индекс остановки %1 вне маршрута").arg(stopIndex));
     }
+    return offsets[stopIndex];
+}
 
-    // Начальная остановка - время отправления
-    stops[0].arrivalTime = startTime;
-
-    TimeTransport currentTime = startTime;
+TimeTransport Route::getArrivalTime(int stopIndex, const TimeTransport& startTime) const {
+    return startTime.addMinutes(getOffsetAtStop(stopIndex));
+}
 
-    // Рассчитываем время прибытия для каждой следующей остановки
-    for (int i = 1; i < stops.size(); i++) {
-        if (i - 1 < travelTimes.size()) {
-            currentTime = currentTime.addMinutes(travelTimes[i - 1]);
-            stops[i].arrivalTime = currentTime;
-        }
+TimeTransport Route::getArrivalTimeAtStop(StopId stopId, const TimeTransport& startTime) const {
+    if (int index = indexOfStop(stopId); index != -1) {
+        return startTime.addMinutes(offsets[index]);
     }
+    throw StopNotFoundException(StopRegistry::instance().name(stopId));
+}
 
-    // Отладочный вывод
-    qDebug() << "Маршрут №" << getRouteNumber() << "расписание остановок:";
-    for (const auto& stop : stops) {
-        qDebug() << "  " << stop.getName() << "->" << stop.arrivalTime.toString();
+TimeTransport Route::getArrivalTimeAtStop(const QString& stopName, const TimeTransport& startTime) const {
+    if (StopId stopId = StopRegistry::instance().find(stopName); containsStop(stopId)) {
+        return getArrivalTimeAtStop(stopId, startTime);
     }
+    throw StopNotFoundException(stopName);
 }
 
-TimeTransport Route::getArrivalTimeAtStop(const QString& stopName) const {
-    for (const auto& routeStop : stops) {
-        if (routeStop.stop->getName().compare(stopName, Qt::CaseInsensitive) == 0) {
-            return routeStop.arrivalTime;
+int Route::indexOfStop(StopId stopId) const {
+    for (int i = 0; i < stops.size(); ++i) {
+        if (stops[i].stopId == stopId) {
+            return i;
         }
     }
-    throw StopNotFoundException(stopName);
+    return -1;
 }
 
-QVector<RouteStop> Route::getStops() const {
-    return stops;
+bool Route::containsStop(StopId stopId) const {
+    return indexOfStop(stopId) != -1;
 }
 
-Transport Route::getTransport() const {
+std::span<const RouteStop> Route::getStops() const {
+    return {stops.constData(), static_cast<std::size_t>(stops.size())};
+}
+
+const Transport& Route::getTransport() const {
     return transport;
 }
 
-QSharedPointer<Stop> Route::getStartStop() const {
+StopId Route::getStartStopId() const {
     return startStop;
 }
 
-QSharedPointer<Stop> Route::getEndStop() const {
+StopId Route::getEndStopId() const {
     return endStop;
 }
 
-QStringList Route::getDays() const {
+QString Route::getStartStopName() const {
+    return StopRegistry::instance().name(startStop);
+}
+
+QString Route::getEndStopName() const {
+    return StopRegistry::instance().name(endStop);
+}
+
+DayMask Route::getDays() const {
     return days;
 }
 
-void Route::setDays(const QStringList& newDays) {
+void Route::setDays(DayMask newDays) {
     days = newDays;
 }
 
-QVector<int> Route::getTravelTimes() const {
-    return travelTimes;
+std::span<const int> Route::getTravelTimes() const {
+    return {travelTimes.constData(), static_cast<std::size_t>(travelTimes.size())};
+}
+
+std::span<const int> Route::getOffsets() const {
+    return {offsets.constData(), static_cast<std::size_t>(offsets.size())};
 }
 
 int Route::getRouteNumber() const {
     return transport.getId();
 }
+
+bool Route::hasSamePattern(const Route& other) const {
+    if (transport.getId() != other.transport.getId()
+        || transport.getType() != other.transport.getType()
+        || days != other.days
+        || travelTimes != other.travelTimes
+        || stops.size() != other.stops.size()) {
+        return false;
+    }
+
+    return std::ranges::equal(stops, other.stops,
+                              [](const RouteStop& a, const RouteStop& b) {
+                                  return a.stopId == b.stopId;
+                              });
+}
@@ -3,11 +3,13 @@
 
 #include <QVector>
 #include <QString>
-#include <QSharedPointer>
+#include <QStringList>
+#include <span>
 #include <stdexcept>
 #include "Transport.h"
-#include "Stop.h"
+#include "StopRegistry.h"
 #include "TimeTransport.h"
+#include "DayMask.h"
 
 // Исключения для маршрутов
 class RouteException : public std::runtime_error {
@@ -30,37 +32,45 @@ public:
 
 class RouteStop {
 public:
-    QSharedPointer<Stop> stop;
-    TimeTransport arrivalTime;
+    StopId stopId;
 
-    explicit RouteStop(QSharedPointer<Stop> stop, const TimeTransport& time);
+    explicit RouteStop(StopId stopId);
     QString getName() const;
 };
 
 class Route {
 public:
-    explicit Route(const Transport& transport, QSharedPointer<Stop> start, QSharedPointer<Stop> end);
+    explicit Route(const Transport& transport, StopId start, StopId end);
 
-    void addStop(QSharedPointer<Stop> stop, int travelTimeFromPrevious);
+    void addStop(StopId stopId, int travelTimeFromPrevious);
     void addFinalTravelTime(int travelTime);
-    void calculateArrivalTimes(const TimeTransport& startTime);
-    TimeTransport getArrivalTimeAtStop(const QString& stopName) const;
-    QVector<RouteStop> getStops() const;
-    Transport getTransport() const;
-    QSharedPointer<Stop> getStartStop() const;
-    QSharedPointer<Stop> getEndStop() const;
-    QStringList getDays() const;
-    void setDays(const QStringList& days);
-    QVector<int> getTravelTimes() const;
+    int getOffsetAtStop(int stopIndex) const;
+    TimeTransport getArrivalTime(int stopIndex, const TimeTransport& startTime) const;
+    TimeTransport getArrivalTimeAtStop(StopId stopId, const TimeTransport& startTime) const;
+    TimeTransport getArrivalTimeAtStop(const QString& stopName, const TimeTransport& startTime) const;
+    int indexOfStop(StopId stopId) const;
+    bool containsStop(StopId stopId) const;
+    std::span<const RouteStop> getStops() const;
+    const Transport& getTransport() const;
+    StopId getStartStopId() const;
+    StopId getEndStopId() const;
+    QString getStartStopName() const;
+    QString getEndStopName() const;
+    DayMask getDays() const;
+    void setDays(DayMask days);
+    std::span<const int> getTravelTimes() const;
+    std::span<const int> getOffsets() const;
     int getRouteNumber() const;
+    bool hasSamePattern(const Route& other) const;
 
 private:
     Transport transport;
-    QSharedPointer<Stop> startStop;
-    QSharedPointer<Stop> endStop;
+    StopId startStop;
+    StopId endStop;
     QVector<RouteStop> stops;
     QVector<int> travelTimes;
-    QStringList days;
+    QVector<int> offsets; // минуты от отправления до каждой остановки
+    DayMask days;
 };
 
 #endif
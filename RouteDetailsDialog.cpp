@@ -5,6 +5,8 @@
 #include <QLineEdit>
 #include <QComboBox>
 #include <QInputDialog>
+#include <QSignalBlocker>
+#include <algorithm>
 
 RouteDetailsDialog::RouteDetailsDialog(TransportSchedule* transportSchedule, const Schedule& schedule, QWidget *parent)
     : QDialog(parent), transportSchedule(transportSchedule), currentSchedule(schedule),
@@ -22,19 +24,29 @@ void RouteDetailsDialog::setupUI(const Route& route, const TimeTransport& startT
     // Информация о маршруте
     infoLabel = new QLabel(
         QString("<b>%1 №%2</b><br>"
-                "Начало: %3 | Дни: %4")
+                "Отправления: %3 | Дни: %4")
             .arg(route.getTransport().getType().getName(),
                  QString::number(route.getRouteNumber()),
-                 startTime.toString(),
-                 route.getDays().join(", ")));
+                 ArrivalTimeService::formatTrips(currentSchedule),
+                 route.getDays().toString()));
     mainLayout->addWidget(infoLabel);
 
+    // Выбор рейса, для которого показывается время прибытия
+    auto* tripLayout = new QHBoxLayout;
+    tripLayout->addWidget(new QLabel("Рейс:"));
+    tripCombo = new QComboBox;
+    populateTripCombo();
+    connect(tripCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &RouteDetailsDialog::selectTrip);
+    tripLayout->addWidget(tripCombo);
+    tripLayout->addStretch();
+    mainLayout->addLayout(tripLayout);
+
     // Панель редактирования (скрыта по умолчанию)
     editPanel = new QWidget;
     auto* editLayout = new QHBoxLayout(editPanel);
     editPanel->setVisible(false);
 
-    editLayout->addWidget(new QLabel("Время начала:"));
+    editLayout->addWidget(new QLabel("Отправление рейса:"));
     startHourSpin = new QSpinBox;
     startHourSpin->setRange(0, 23);
     startHourSpin->setValue(startTime.hours);
@@ -52,7 +64,7 @@ void RouteDetailsDialog::setupUI(const Route& route, const TimeTransport& startT
     editLayout->addWidget(new QLabel("Дни работы:"));
     daysCombo = new QComboBox;
     daysCombo->addItems(QStringList() << "пн" << "вт" << "ср" << "чт" << "пт" << "сб" << "вс");
-    daysCombo->setCurrentText(route.getDays().join(","));
+    daysCombo->setCurrentText(route.getDays().toStringList().join(","));
     daysCombo->setEditable(true);
     editLayout->addWidget(daysCombo);
 
@@ -89,6 +101,8 @@ void RouteDetailsDialog::setupUI(const Route& route, const TimeTransport& startT
     auto* buttonLayout = new QHBoxLayout;
 
     editButton = new QPushButton("Редактировать");
+    // Без расписания (режим просмотра каталога) маршрут только показывается
+    editButton->setVisible(transportSchedule != nullptr);
     connect(editButton, &QPushButton::clicked, this, &RouteDetailsDialog::editRoute);
 
     saveButton = new QPushButton("Сохранить");
@@ -115,20 +129,48 @@ void RouteDetailsDialog::populateStopsTable() {
     const auto& route = currentSchedule.getRoute();
     const auto stops = route.getStops();
     const auto travelTimes = route.getTravelTimes();
+    const int stopCount = static_cast<int>(stops.size());
 
-    stopsTable->setRowCount(stops.size());
+    stopsTable->setRowCount(stopCount);
 
+    const int tripIndex = selectedTrip();
     int row = 0;
     for (const auto& stop : stops) {
-        populateStopRow(row, stop, stops.size(), travelTimes);
-        setEditingFlagsForRow(row, stops.size());
+        populateStopRow(row, stop, currentSchedule.getArrivalTime(row, tripIndex), stopCount, travelTimes);
+        setEditingFlagsForRow(row, stopCount);
         ++row;
     }
 
     stopsTable->resizeColumnsToContents();
 }
 
-void RouteDetailsDialog::populateStopRow(int row, const RouteStop& stop, int totalStops, const QVector<int>& travelTimes) {
+void RouteDetailsDialog::populateTripCombo() {
+    tripCombo->clear();
+    const auto departures = currentSchedule.getDepartures();
+    for (int i = 0; i < static_cast<int>(departures.size()); ++i) {
+        tripCombo->addItem(QString("%1. %2").arg(i + 1).arg(departures[i].toString()));
+    }
+}
+
+int RouteDetailsDialog::selectedTrip() const {
+    return std::max(tripCombo->currentIndex(), 0);
+}
+
+void RouteDetailsDialog::selectTrip(int tripIndex) {
+    if (tripIndex < 0) return;
+
+    if (isEditing) {
+        // В режиме редактирования меняется отправление выбранного рейса
+        const auto departure = currentSchedule.getDeparture(tripIndex);
+        startHourSpin->setValue(departure.hours);
+        startMinuteSpin->setValue(departure.minutes);
+        calculateArrivalTimes();
+    } else {
+        populateStopsTable();
+    }
+}
+
+void RouteDetailsDialog::populateStopRow(int row, const RouteStop& stop, const TimeTransport& arrivalTime, int totalStops, std::span<const int> travelTimes) {
     // Номер остановки
     auto* numberItem = new QTableWidgetItem(QString::number(row + 1));
     stopsTable->setItem(row, 0, numberItem);
@@ -139,11 +181,11 @@ void RouteDetailsDialog::populateStopRow(int row, const RouteStop& stop, int tot
     stopsTable->setItem(row, 1, nameItem);
 
     // Время прибытия
-    auto* arrivalItem = new QTableWidgetItem(stop.arrivalTime.toString());
+    auto* arrivalItem = new QTableWidgetItem(arrivalTime.toString());
     stopsTable->setItem(row, 2, arrivalItem);
 
     // Время движения
-    const int travelTime = (row > 0 && row - 1 < travelTimes.size()) ? travelTimes[row - 1] : 0;
+    const int travelTime = (row > 0 && row - 1 < static_cast<int>(travelTimes.size())) ? travelTimes[row - 1] : 0;
     auto* travelItem = new QTableWidgetItem(QString::number(travelTime));
     stopsTable->setItem(row, 3, travelItem);
 }
@@ -199,6 +241,14 @@ void RouteDetailsDialog::editRoute() {
     // Показываем панель редактирования
     editPanel->setVisible(true);
 
+    // Редактируется отправление выбранного рейса; частотные интервалы сохраняются как есть
+    const auto departure = currentSchedule.getDeparture(selectedTrip());
+    startHourSpin->setValue(departure.hours);
+    startMinuteSpin->setValue(departure.minutes);
+    const bool hasExplicitDepartures = !currentSchedule.getDepartures().empty();
+    startHourSpin->setEnabled(hasExplicitDepartures);
+    startMinuteSpin->setEnabled(hasExplicitDepartures);
+
     // Показываем/скрываем кнопки
     editButton->setVisible(false);
     saveButton->setVisible(true);
@@ -310,28 +360,24 @@ void RouteDetailsDialog::updateArrivalTimes() {
 void RouteDetailsDialog::calculateArrivalTimes() {
     if (!isEditing) return;
 
-    TimeTransport currentTime(startHourSpin->value(), startMinuteSpin->value());
+    TimeTransport startTime(startHourSpin->value(), startMinuteSpin->value());
 
+    // Накопленное смещение от начала маршрута, как в Route
+    auto offset = 0;
     for (auto i = 0; i < stopsTable->rowCount(); ++i) {
-        auto arrivalTime = calculateArrivalTime(i);
-        stopsTable->item(i, 2)->setText(arrivalTime.toString());
+        if (i > 0) {
+            offset += travelTimeAtRow(i);
+        }
+        stopsTable->item(i, 2)->setText(startTime.addMinutes(offset).toString());
     }
 }
 
-TimeTransport RouteDetailsDialog::calculateArrivalTime(int stopIndex) {
-    if (stopIndex == 0) {
-        return TimeTransport(startHourSpin->value(), startMinuteSpin->value());
-    }
-
-    auto previousTime = calculateArrivalTime(stopIndex - 1);
-
+int RouteDetailsDialog::travelTimeAtRow(int row) const {
     // Получаем время движения от предыдущей остановки
-    auto travelTime = 0;
-    if (const auto* travelItem = stopsTable->item(stopIndex, 3); travelItem) {
-        travelTime = travelItem->text().toInt();
+    if (const auto* travelItem = stopsTable->item(row, 3); travelItem) {
+        return travelItem->text().toInt();
     }
-
-    return previousTime.addMinutes(travelTime);
+    return 0;
 }
 
 QString RouteDetailsDialog::extractStopNameFromTable(int row) const {
@@ -398,32 +444,37 @@ QStringList RouteDetailsDialog::parseDays() const {
 
 void RouteDetailsDialog::createAndSaveRoute(const QVector<QSharedPointer<Stop>>& collectedStops, const QVector<int>& collectedTravelTimes, const QStringList& days) {
     const auto& originalTransport = originalRoute.getTransport();
-    Route newRoute(originalTransport, collectedStops[0], collectedStops[collectedStops.size() - 1]);
+    Route newRoute(originalTransport, collectedStops[0]->getId(), collectedStops[collectedStops.size() - 1]->getId());
 
     // Добавляем промежуточные остановки
     const int intermediateStopCount = collectedStops.size() >= 2 ? static_cast<int>(collectedStops.size()) - 2 : 0;
     for (int i = 0; i < intermediateStopCount; ++i) {
         const int stopIndex = i + 1;
-        newRoute.addStop(collectedStops[stopIndex], collectedTravelTimes[i]);
+        newRoute.addStop(collectedStops[stopIndex]->getId(), collectedTravelTimes[i]);
     }
 
     // Добавляем время до конечной остановки
     newRoute.addFinalTravelTime(collectedTravelTimes[collectedTravelTimes.size() - 1]);
 
-    // Сохраняем дни работы
-    newRoute.setDays(days);
-
-    // Создаем время начала
-    TimeTransport startTime(startHourSpin->value(), startMinuteSpin->value());
-
-    // Рассчитываем время прибытия
-    newRoute.calculateArrivalTimes(startTime);
+    // Сохраняем дни работы (строки переводятся в маску на границе UI)
+    if (auto daysValidation = ValidationService::validateDays(days); !daysValidation.isValid) {
+        throw InvalidRouteDataException(daysValidation.errorMessage);
+    }
+    const DayMask dayMask = DayMask::fromStringList(days);
+    newRoute.setDays(dayMask);
+
+    // Заменяем отправление выбранного рейса, остальные рейсы сохраняются
+    const auto oldDepartures = currentSchedule.getDepartures();
+    QVector<TimeTransport> departures(oldDepartures.begin(), oldDepartures.end());
+    if (!departures.isEmpty()) {
+        departures[selectedTrip()] = TimeTransport(startHourSpin->value(), startMinuteSpin->value());
+    }
+    const auto oldFrequencies = currentSchedule.getFrequencies();
+    const QVector<FrequencyTrip> frequencies(oldFrequencies.begin(), oldFrequencies.end());
 
     // Создаем новое расписание
-    Schedule newSchedule(newRoute, startTime);
-
-    // Обновляем маршрут в расписании
-    transportSchedule->removeRoute(originalRoute.getRouteNumber());
+    Schedule newSchedule(newRoute, departures);
+    newSchedule.setFrequencies(frequencies);
 
     // Создаем промежуточные остановки (исключая первую и последнюю)
     QVector<QSharedPointer<Stop>> intermediateStops;
@@ -438,15 +489,23 @@ void RouteDetailsDialog::createAndSaveRoute(const QVector<QSharedPointer<Stop>>&
         collectedStops[collectedStops.size() - 1],
         intermediateStops,
         collectedTravelTimes,
-        days,
-        startTime
+        dayMask,
+        departures,
+        frequencies
         );
 
-    transportSchedule->addRoute(params);
+    // Заменяется только открытый шаблон; другие шаблоны с этим номером (например,
+    // выходного дня) сохраняются. Транзакция применяет замену целиком или не применяет
+    TransportSchedule::Transaction transaction;
+    transaction.updatePattern(originalRoute, params);
+    transportSchedule->commitTransaction(transaction);
 
     // Обновляем текущее расписание
     currentSchedule = newSchedule;
     originalRoute = newRoute;
+
+    const QSignalBlocker blocker(tripCombo);
+    populateTripCombo();
 }
 
 void RouteDetailsDialog::saveRoute() {
@@ -18,6 +18,7 @@ class RouteDetailsDialog : public QDialog {
     Q_OBJECT
 
 public:
+    // transportSchedule == nullptr - просмотр без редактирования
     explicit RouteDetailsDialog(TransportSchedule* transportSchedule, const Schedule& schedule, QWidget *parent = nullptr);
 
 private slots:
@@ -27,11 +28,14 @@ private slots:
     void addStop();
     void removeStop();
     void updateArrivalTimes();
+    void selectTrip(int tripIndex);
 
 private:
     void setupUI(const Route& route, const TimeTransport& startTime);
+    void populateTripCombo();
+    int selectedTrip() const;
     void populateStopsTable();
-    void populateStopRow(int row, const RouteStop& stop, int totalStops, const QVector<int>& travelTimes);
+    void populateStopRow(int row, const RouteStop& stop, const TimeTransport& arrivalTime, int totalStops, std::span<const int> travelTimes);
     QString formatStopName(const QString& name, int index, int totalStops) const;
     void setEditingFlagsForRow(int row, int totalStops)const;
     bool shouldBeEditable(int col, int row, int totalStops) const;
@@ -42,7 +46,7 @@ private:
     QStringList parseDays() const;
     void createAndSaveRoute(const QVector<QSharedPointer<Stop>>& collectedStops, const QVector<int>& collectedTravelTimes, const QStringList& days);
     void calculateArrivalTimes();
-    TimeTransport calculateArrivalTime(int stopIndex);
+    int travelTimeAtRow(int row) const;
 
     TransportSchedule* transportSchedule;
     Schedule currentSchedule;
@@ -60,6 +64,7 @@ private:
     QSpinBox* startHourSpin;
     QSpinBox* startMinuteSpin;
     QComboBox* daysCombo;
+    QComboBox* tripCombo;
 
     bool isEditing = false;
 };
@@ -1,23 +1,193 @@
 #include "Schedule.h"
+#include "ArrivalTimeService.h"
+#include <algorithm>
+
+std::atomic<quint64> Schedule::nextRevision{1};
 
 Schedule::Schedule(const Route& route, const TimeTransport& startTime)
-    : route(route), startTime(startTime) {
-    calculateRouteTimes();
+    : route(route), departures({startTime}), revision(nextRevision++) {}
+
+Schedule::Schedule(const Route& route, const QVector<TimeTransport>& departures)
+    : route(route) {
+    setDepartures(departures);
 }
 
-Route Schedule::getRoute() const {
+quint64 Schedule::getRevision() const {
+    return revision;
+}
+
+void Schedule::touch() {
+    revision = nextRevision++;
+}
+
+const Route& Schedule::getRoute() const {
     return route;
 }
 
 TimeTransport Schedule::getStartTime() const {
-    return startTime;
+    std::optional<TimeTransport> first;
+    if (!departures.isEmpty()) {
+        first = departures.first();
+    }
+    for (const auto& frequency : frequencies) {
+        if (!first || frequency.getStart() < *first) {
+            first = frequency.getStart();
+        }
+    }
+    return first.value_or(TimeTransport());
 }
 
 void Schedule::setStartTime(const TimeTransport& time) {
-    startTime = time;
-    calculateRouteTimes();
+    // Сдвигаем все рейсы так, чтобы первый отправлялся в указанное время;
+    // время прибытия вычисляется из смещений маршрута, пересчет не нужен
+    const int shift = time.toMinutes() - getStartTime().toMinutes();
+    QVector<TimeTransport> shifted;
+    shifted.reserve(departures.size());
+    for (const auto& departure : departures) {
+        shifted.push_back(departure.addMinutes(shift + ArrivalTimeService::MINUTES_IN_DAY));
+    }
+    setDepartures(shifted);
+
+    // Интервал, перешедший через полночь, делится на два: до полуночи и после.
+    // Иначе начало окажется позже конца, и рейсы интервала пропадут
+    const int minutesPerDay = ArrivalTimeService::MINUTES_IN_DAY;
+    QVector<FrequencyTrip> shiftedFrequencies;
+    shiftedFrequencies.reserve(frequencies.size());
+    for (const auto& frequency : frequencies) {
+        const int headway = frequency.getHeadway();
+        const int start = (frequency.getStart().toMinutes() + shift + minutesPerDay) % minutesPerDay;
+        const int end = (frequency.getEnd().toMinutes() + shift + minutesPerDay) % minutesPerDay;
+        if (start <= end || headway <= 0) {
+            shiftedFrequencies.push_back(FrequencyTrip(TimeTransport(0, start), TimeTransport(0, end), headway));
+            continue;
+        }
+
+        // Последний рейс до полуночи и первый после нее; все рейсы интервала сохраняются
+        const int lastBeforeMidnight = start + (minutesPerDay - 1 - start) / headway * headway;
+        shiftedFrequencies.push_back(FrequencyTrip(TimeTransport(0, start), TimeTransport(0, lastBeforeMidnight), headway));
+        if (const int firstAfterMidnight = lastBeforeMidnight + headway - minutesPerDay; firstAfterMidnight <= end) {
+            shiftedFrequencies.push_back(FrequencyTrip(TimeTransport(0, firstAfterMidnight), TimeTransport(0, end), headway));
+        }
+    }
+    frequencies = shiftedFrequencies;
+    touch();
+}
+
+std::span<const TimeTransport> Schedule::getDepartures() const {
+    return {departures.constData(), static_cast<std::size_t>(departures.size())};
+}
+
+void Schedule::setDepartures(const QVector<TimeTransport>& newDepartures) {
+    departures = newDepartures;
+    std::ranges::sort(departures);
+    auto [first, last] = std::ranges::unique(departures);
+    departures.erase(first, last);
+    touch();
+}
+
+void Schedule::addDeparture(const TimeTransport& time) {
+    auto it = std::ranges::lower_bound(departures, time);
+    if (it == departures.end() || *it != time) {
+        departures.insert(it, time);
+        touch();
+    }
+}
+
+std::span<const FrequencyTrip> Schedule::getFrequencies() const {
+    return {frequencies.constData(), static_cast<std::size_t>(frequencies.size())};
+}
+
+void Schedule::setFrequencies(const QVector<FrequencyTrip>& newFrequencies) {
+    frequencies = newFrequencies;
+    touch();
 }
 
-void Schedule::calculateRouteTimes() {
-    route.calculateArrivalTimes(startTime);
+void Schedule::addFrequency(const FrequencyTrip& frequency) {
+    if (!frequencies.contains(frequency)) {
+        frequencies.push_back(frequency);
+        touch();
+    }
+}
+
+int Schedule::getTripCount() const {
+    int tripCount = departures.size();
+    for (const auto& frequency : frequencies) {
+        tripCount += frequency.getTripCount();
+    }
+    return tripCount;
+}
+
+TimeTransport Schedule::getDeparture(int tripIndex) const {
+    if (tripIndex < departures.size()) {
+        return departures.value(tripIndex);
+    }
+
+    int index = tripIndex - departures.size();
+    for (const auto& frequency : frequencies) {
+        if (index < frequency.getTripCount()) {
+            return frequency.getDeparture(index);
+        }
+        index -= frequency.getTripCount();
+    }
+    return getStartTime();
+}
+
+QVector<TimeTransport> Schedule::expandDepartures() const {
+    QVector<TimeTransport> all = departures;
+    for (const auto& frequency : frequencies) {
+        all += frequency.expand();
+    }
+    std::ranges::sort(all);
+    auto [first, last] = std::ranges::unique(all);
+    all.erase(first, last);
+    return all;
+}
+
+TimeTransport Schedule::getArrivalTime(int stopIndex, int tripIndex) const {
+    return route.getArrivalTime(stopIndex, getDeparture(tripIndex));
+}
+
+TimeTransport Schedule::getArrivalTimeAtStop(StopId stopId, int tripIndex) const {
+    return route.getArrivalTimeAtStop(stopId, getDeparture(tripIndex));
+}
+
+std::optional<TripArrival> Schedule::findNextArrival(StopId stopId, const TimeTransport& currentTime) const {
+    const int stopIndex = route.indexOfStop(stopId);
+    if (stopIndex == -1 || getTripCount() == 0) {
+        return std::nullopt;
+    }
+
+    // Ищем первый рейс, отправившийся не раньше (текущее время - смещение остановки)
+    const int offset = route.getOffsetAtStop(stopIndex);
+    const int minutesPerDay = ArrivalTimeService::MINUTES_IN_DAY;
+    const int targetMinutes = ((currentTime.toMinutes() - offset) % minutesPerDay + minutesPerDay) % minutesPerDay;
+
+    std::optional<TripArrival> best;
+    auto consider = [&](int tripIndex, const TimeTransport& departure) {
+        const TimeTransport arrivalTime = departure.addMinutes(offset);
+        const int waitMinutes = ArrivalTimeService::calculateWaitTime(currentTime, arrivalTime);
+        if (!best || waitMinutes < best->waitMinutes) {
+            best = TripArrival{this, tripIndex, arrivalTime, waitMinutes};
+        }
+    };
+
+    if (!departures.isEmpty()) {
+        auto it = std::ranges::lower_bound(departures, TimeTransport(0, targetMinutes));
+        if (it == departures.end()) {
+            it = departures.begin(); // следующий рейс - первый завтрашний
+        }
+        consider(static_cast<int>(std::distance(departures.begin(), it)), *it);
+    }
+
+    // Частотные рейсы: ближайший находится делением, без перебора отправлений
+    int firstTripIndex = departures.size();
+    for (const auto& frequency : frequencies) {
+        if (frequency.getTripCount() > 0) {
+            const int tripIndex = frequency.firstTripAtOrAfter(targetMinutes).value_or(0);
+            consider(firstTripIndex + tripIndex, frequency.getDeparture(tripIndex));
+        }
+        firstTripIndex += frequency.getTripCount();
+    }
+
+    return best;
 }
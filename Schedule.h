@@ -1,21 +1,62 @@
 #ifndef SCHEDULE_H
 #define SCHEDULE_H
 
+#include <QVector>
+#include <QtGlobal>
+#include <atomic>
+#include <optional>
+#include <span>
 #include "Route.h"
 #include "TimeTransport.h"
+#include "FrequencyTrip.h"
 
+class Schedule;
+
+// Ближайший рейс шаблона маршрута через остановку
+struct TripArrival {
+    const Schedule* schedule;
+    int tripIndex;
+    TimeTransport arrivalTime;
+    int waitMinutes;
+};
+
+// Шаблон маршрута (последовательность остановок и смещений) с отсортированным
+// списком времен отправления и частотными рейсами. Рейсы нумеруются так:
+// сначала явные отправления, затем рейсы каждого частотного интервала.
 class Schedule {
 public:
     explicit Schedule(const Route& route, const TimeTransport& startTime);
+    explicit Schedule(const Route& route, const QVector<TimeTransport>& departures);
 
-    Route getRoute() const;
+    const Route& getRoute() const;
     TimeTransport getStartTime() const;
+    // Сдвиг всех рейсов; частотный интервал, перешедший через полночь, делится на два
     void setStartTime(const TimeTransport& time);
-    void calculateRouteTimes();
+    std::span<const TimeTransport> getDepartures() const;
+    void setDepartures(const QVector<TimeTransport>& newDepartures);
+    void addDeparture(const TimeTransport& time);
+    std::span<const FrequencyTrip> getFrequencies() const;
+    void setFrequencies(const QVector<FrequencyTrip>& newFrequencies);
+    void addFrequency(const FrequencyTrip& frequency);
+    int getTripCount() const;
+    TimeTransport getDeparture(int tripIndex) const;
+    QVector<TimeTransport> expandDepartures() const;
+    TimeTransport getArrivalTime(int stopIndex, int tripIndex = 0) const;
+    TimeTransport getArrivalTimeAtStop(StopId stopId, int tripIndex = 0) const;
+    std::optional<TripArrival> findNextArrival(StopId stopId, const TimeTransport& currentTime) const;
+
+    // Ревизия содержимого: меняется при каждом изменении, копии ее разделяют.
+    // Используется для кэширования сериализованного представления
+    quint64 getRevision() const;
 
 private:
+    void touch();
+
+    static std::atomic<quint64> nextRevision;
     Route route;
-    TimeTransport startTime;
+    QVector<TimeTransport> departures;
+    QVector<FrequencyTrip> frequencies;
+    quint64 revision;
 };
 
 #endif
@@ -0,0 +1,121 @@
+#include "ScheduleCatalog.h"
+#include "StopRegistry.h"
+#include <QDebug>
+
+ScheduleCatalog::ScheduleCatalog(qsizetype memoryBudget) : cache(memoryBudget) {}
+
+bool ScheduleCatalog::open(const QString& filename, QString* errorMessage)
+{
+    close();
+    if (!snapshot.open(filename, errorMessage)) {
+        return false;
+    }
+
+    stopIds.fill(StopRegistry::INVALID_ID, snapshot.stopCount());
+    qDebug() << "Opened schedule catalog" << filename << "with" << snapshot.scheduleCount() << "routes";
+    return true;
+}
+
+void ScheduleCatalog::close()
+{
+    cache.clear();
+    stopIds.clear();
+    snapshot.close();
+}
+
+int ScheduleCatalog::routeCount() const
+{
+    return snapshot.isOpen() ? snapshot.scheduleCount() : 0;
+}
+
+std::optional<ScheduleCatalog::RouteHeader> ScheduleCatalog::header(int scheduleIndex) const
+{
+    if (scheduleIndex < 0 || scheduleIndex >= routeCount()) {
+        return std::nullopt;
+    }
+
+    const auto& record = snapshot.scheduleRecord(scheduleIndex);
+    const auto stops = snapshot.routeStops(scheduleIndex);
+
+    int tripCount = static_cast<int>(record.departureCount);
+    for (const auto& frequency : snapshot.frequencies(scheduleIndex)) {
+        if (frequency.headway > 0 && frequency.startMinute <= frequency.endMinute) {
+            tripCount += (frequency.endMinute - frequency.startMinute) / frequency.headway + 1;
+        }
+    }
+
+    return RouteHeader{record.routeNumber,
+                       TransportType(static_cast<TransportType::Type>(record.transportType)),
+                       DayMask(record.days),
+                       stops.empty() ? QString() : snapshot.stopName(static_cast<int>(stops.front())),
+                       stops.empty() ? QString() : snapshot.stopName(static_cast<int>(stops.back())),
+                       tripCount};
+}
+
+QSharedPointer<const Schedule> ScheduleCatalog::schedule(int scheduleIndex)
+{
+    if (scheduleIndex < 0 || scheduleIndex >= routeCount()) {
+        return {};
+    }
+    if (auto* cached = cache.object(scheduleIndex)) {
+        return *cached;
+    }
+
+    // Интернируются только остановки этого маршрута
+    for (quint32 stop : snapshot.routeStops(scheduleIndex)) {
+        stopId(stop);
+    }
+
+    auto schedule = snapshot.materialize(scheduleIndex, {stopIds.constData(), static_cast<std::size_t>(stopIds.size())});
+    if (!schedule) {
+        return {};
+    }
+
+    auto result = QSharedPointer<const Schedule>::create(*schedule);
+    // Шаблон дороже бюджета не кэшируется, но возвращается вызывающему
+    cache.insert(scheduleIndex, new QSharedPointer<const Schedule>(result), estimateCost(*result));
+    return result;
+}
+
+int ScheduleCatalog::findRoute(int routeNumber) const
+{
+    for (int i = 0; i < routeCount(); ++i) {
+        if (snapshot.scheduleRecord(i).routeNumber == routeNumber) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void ScheduleCatalog::setMemoryBudget(qsizetype bytes)
+{
+    cache.setMaxCost(bytes);
+}
+
+qsizetype ScheduleCatalog::memoryBudget() const
+{
+    return cache.maxCost();
+}
+
+qsizetype ScheduleCatalog::cachedBytes() const
+{
+    return cache.totalCost();
+}
+
+qsizetype ScheduleCatalog::estimateCost(const Schedule& schedule)
+{
+    const Route& route = schedule.getRoute();
+    return static_cast<qsizetype>(sizeof(Schedule)
+        + route.getStops().size() * (sizeof(RouteStop) + 2 * sizeof(int))
+        + schedule.getDepartures().size() * sizeof(TimeTransport)
+        + schedule.getFrequencies().size() * sizeof(FrequencyTrip));
+}
+
+StopId ScheduleCatalog::stopId(quint32 snapshotStopIndex)
+{
+    StopId& id = stopIds[snapshotStopIndex];
+    if (id == StopRegistry::INVALID_ID) {
+        id = StopRegistry::instance().intern(snapshot.stopName(static_cast<int>(snapshotStopIndex)));
+    }
+    return id;
+}
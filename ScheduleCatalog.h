@@ -0,0 +1,61 @@
+#ifndef SCHEDULECATALOG_H
+#define SCHEDULECATALOG_H
+
+#include <QCache>
+#include <QSharedPointer>
+#include <QVector>
+#include <optional>
+#include "ScheduleSnapshot.h"
+#include "Schedule.h"
+#include "TransportType.h"
+#include "DayMask.h"
+
+// Ленивый доступ к расписанию из бинарного снимка для режима чтения
+// (киоски, устройства с малой памятью). При открытии в памяти нет ни одного
+// Schedule: заголовки маршрутов читаются прямо из отображенного файла, а полные
+// шаблоны собираются по запросу и держатся в LRU-кэше с бюджетом в байтах.
+class ScheduleCatalog
+{
+public:
+    static constexpr qsizetype DEFAULT_MEMORY_BUDGET = 16 * 1024 * 1024;
+
+    // Сведения для списка маршрутов без сборки Route
+    struct RouteHeader {
+        int routeNumber;
+        TransportType transportType;
+        DayMask days;
+        QString firstStopName;
+        QString lastStopName;
+        int tripCount;
+    };
+
+    explicit ScheduleCatalog(qsizetype memoryBudget = DEFAULT_MEMORY_BUDGET);
+
+    bool open(const QString& filename, QString* errorMessage = nullptr);
+    void close();
+
+    int routeCount() const;
+    // std::nullopt, если индекс вне [0, routeCount())
+    std::optional<RouteHeader> header(int scheduleIndex) const;
+
+    // Полный шаблон маршрута или пустой указатель для индекса вне диапазона;
+    // вытеснение из кэша не инвалидирует выданный указатель
+    QSharedPointer<const Schedule> schedule(int scheduleIndex);
+    // Индекс первого шаблона с номером маршрута или -1
+    int findRoute(int routeNumber) const;
+
+    void setMemoryBudget(qsizetype bytes);
+    qsizetype memoryBudget() const;
+    qsizetype cachedBytes() const;
+
+private:
+    static qsizetype estimateCost(const Schedule& schedule);
+    StopId stopId(quint32 snapshotStopIndex);
+
+    ScheduleSnapshot snapshot;
+    // StopId остановок снимка, интернируются при первом обращении
+    QVector<StopId> stopIds;
+    QCache<int, QSharedPointer<const Schedule>> cache;
+};
+
+#endif // SCHEDULECATALOG_H
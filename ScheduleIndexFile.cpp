@@ -0,0 +1,288 @@
+#include "ScheduleIndexFile.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QDebug>
+#include "ArrivalTimeService.h"
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable_v<DepartureIndex::Entry>);
+static_assert(std::is_trivially_copyable_v<DepartureIndex::FrequencyRef>);
+static_assert(std::is_trivially_copyable_v<StopRouteIndex::Posting>);
+
+namespace {
+template<typename T>
+void appendRaw(QByteArray& out, const T* data, std::size_t count)
+{
+    out.append(reinterpret_cast<const char*>(data), static_cast<qsizetype>(count * sizeof(T)));
+}
+
+template<typename T>
+bool inBounds(qint64 fileSize, quint32 offset, quint32 count)
+{
+    return offset % alignof(T) == 0
+        && static_cast<qint64>(offset) + static_cast<qint64>(count) * static_cast<qint64>(sizeof(T)) <= fileSize;
+}
+}
+
+QString ScheduleIndexFile::pathFor(const QString& dataFile)
+{
+    return dataFile + ".idx";
+}
+
+bool ScheduleIndexFile::stampDataFile(const QString& dataFile, Header& header, QString* errorMessage)
+{
+    QFile file(dataFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage) *errorMessage = "Cannot open data file for hashing: " + dataFile;
+        return false;
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (!hash.addData(&file)) {
+        if (errorMessage) *errorMessage = "Cannot hash data file: " + dataFile;
+        return false;
+    }
+    const QByteArray digest = hash.result();
+
+    header.dataSize = file.size();
+    header.dataModified = QFileInfo(dataFile).lastModified().toMSecsSinceEpoch();
+    std::memcpy(header.dataHash, digest.constData(), sizeof(header.dataHash));
+    return true;
+}
+
+bool ScheduleIndexFile::write(const QString& dataFile, const QVector<QSharedPointer<Stop>>& allStops, int scheduleCount,
+                              const DepartureIndex& departureIndex, const StopRouteIndex& stopRouteIndex,
+                              QString* errorMessage)
+{
+    Header header{};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    if (!stampDataFile(dataFile, header, errorMessage)) {
+        return false;
+    }
+
+    QVector<StopRecord> stops;
+    QByteArray entries;
+    QByteArray frequencies;
+    QByteArray postings;
+    stops.reserve(allStops.size());
+    for (const auto& stop : allStops) {
+        const auto stopEntries = departureIndex.entriesForStop(stop->getId());
+        const auto stopFrequencies = departureIndex.frequenciesForStop(stop->getId());
+        const auto stopPostings = stopRouteIndex.postingsForStop(stop->getId());
+
+        stops.push_back(StopRecord{header.entryCount, static_cast<quint32>(stopEntries.size()),
+                                   header.frequencyCount, static_cast<quint32>(stopFrequencies.size()),
+                                   header.postingCount, static_cast<quint32>(stopPostings.size())});
+        header.entryCount += static_cast<quint32>(stopEntries.size());
+        header.frequencyCount += static_cast<quint32>(stopFrequencies.size());
+        header.postingCount += static_cast<quint32>(stopPostings.size());
+
+        appendRaw(entries, stopEntries.data(), stopEntries.size());
+        appendRaw(frequencies, stopFrequencies.data(), stopFrequencies.size());
+        appendRaw(postings, stopPostings.data(), stopPostings.size());
+    }
+
+    // Все массивы состоят из 32-битных полей, поэтому смещения выровнены на 4 байта
+    header.stopCount = static_cast<quint32>(stops.size());
+    header.scheduleCount = static_cast<quint32>(scheduleCount);
+    header.stopsOffset = sizeof(Header);
+    header.entriesOffset = header.stopsOffset + header.stopCount * sizeof(StopRecord);
+    header.frequenciesOffset = header.entriesOffset + static_cast<quint32>(entries.size());
+    header.postingsOffset = header.frequenciesOffset + static_cast<quint32>(frequencies.size());
+
+    QSaveFile file(pathFor(dataFile));
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorMessage) *errorMessage = "Cannot open index file for writing: " + file.fileName();
+        return false;
+    }
+
+    QByteArray payload;
+    payload.reserve(header.postingsOffset - sizeof(Header) + postings.size());
+    appendRaw(payload, stops.constData(), stops.size());
+    payload.append(entries);
+    payload.append(frequencies);
+    payload.append(postings);
+    const QByteArray payloadHash = QCryptographicHash::hash(payload, QCryptographicHash::Sha1);
+    std::memcpy(header.payloadHash, payloadHash.constData(), sizeof(header.payloadHash));
+
+    QByteArray out;
+    out.reserve(sizeof(Header) + payload.size());
+    appendRaw(out, &header, 1);
+    out.append(payload);
+
+    if (file.write(out) != out.size() || !file.commit()) {
+        if (errorMessage) *errorMessage = "Cannot write index file: " + file.fileName();
+        return false;
+    }
+    return true;
+}
+
+bool ScheduleIndexFile::validStop(StopId stopId, const QVector<Schedule>& schedules,
+                                  std::span<const DepartureIndex::Entry> entries,
+                                  std::span<const DepartureIndex::FrequencyRef> frequencies,
+                                  std::span<const StopRouteIndex::Posting> postings)
+{
+    const auto routeStopAt = [&](int scheduleIndex, int stopIndex) {
+        if (scheduleIndex < 0 || scheduleIndex >= schedules.size()) {
+            return false;
+        }
+        const auto stops = schedules[scheduleIndex].getRoute().getStops();
+        return stopIndex >= 0 && stopIndex < static_cast<int>(stops.size()) && stops[stopIndex].stopId == stopId;
+    };
+
+    int previousMinute = 0;
+    for (const auto& e : entries) {
+        if (!routeStopAt(e.scheduleIndex, e.stopIndex) || e.minuteOfDay < previousMinute) {
+            return false;
+        }
+        const Schedule& schedule = schedules[e.scheduleIndex];
+        const auto departures = schedule.getDepartures();
+        if (e.tripIndex < 0 || e.tripIndex >= static_cast<int>(departures.size())
+            || e.minuteOfDay != (departures[e.tripIndex].toMinutes() + schedule.getRoute().getOffsetAtStop(e.stopIndex))
+                                    % ArrivalTimeService::MINUTES_IN_DAY) {
+            return false;
+        }
+        previousMinute = e.minuteOfDay;
+    }
+
+    for (const auto& f : frequencies) {
+        if (!routeStopAt(f.scheduleIndex, f.stopIndex)) {
+            return false;
+        }
+        const Schedule& schedule = schedules[f.scheduleIndex];
+        const auto scheduleFrequencies = schedule.getFrequencies();
+        if (f.frequencyIndex < 0 || f.frequencyIndex >= static_cast<int>(scheduleFrequencies.size())
+            || f.offset != schedule.getRoute().getOffsetAtStop(f.stopIndex)) {
+            return false;
+        }
+        int firstTripIndex = static_cast<int>(schedule.getDepartures().size());
+        for (int i = 0; i < f.frequencyIndex; ++i) {
+            firstTripIndex += scheduleFrequencies[i].getTripCount();
+        }
+        if (f.firstTripIndex != firstTripIndex) {
+            return false;
+        }
+    }
+
+    // Список отсортирован по (расписание, позиция) без повторов
+    for (std::size_t i = 0; i < postings.size(); ++i) {
+        const auto& p = postings[i];
+        if (!routeStopAt(p.scheduleIndex, p.position)) {
+            return false;
+        }
+        if (i > 0) {
+            const auto& prev = postings[i - 1];
+            if (prev.scheduleIndex > p.scheduleIndex || (prev.scheduleIndex == p.scheduleIndex && prev.position >= p.position)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool ScheduleIndexFile::load(const QString& dataFile, const QVector<QSharedPointer<Stop>>& allStops,
+                             const QVector<Schedule>& schedules, DepartureIndex& departureIndex,
+                             StopRouteIndex& stopRouteIndex, QString* errorMessage)
+{
+    QFile file(pathFor(dataFile));
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage) *errorMessage = "Index file not found: " + file.fileName();
+        return false;
+    }
+
+    const qint64 size = file.size();
+    const uchar* data = size >= static_cast<qint64>(sizeof(Header)) ? file.map(0, size) : nullptr;
+    if (!data) {
+        if (errorMessage) *errorMessage = "Index file is truncated: " + file.fileName();
+        return false;
+    }
+
+    const auto* header = reinterpret_cast<const Header*>(data);
+    if (header->magic != MAGIC || header->version != VERSION) {
+        if (errorMessage) *errorMessage = "Unsupported index file: " + file.fileName();
+        return false;
+    }
+
+    Header stamp{};
+    if (!stampDataFile(dataFile, stamp, errorMessage)) {
+        return false;
+    }
+    if (header->dataSize != stamp.dataSize || header->dataModified != stamp.dataModified
+        || std::memcmp(header->dataHash, stamp.dataHash, sizeof(stamp.dataHash)) != 0) {
+        if (errorMessage) *errorMessage = "Index file is stale: " + file.fileName();
+        return false;
+    }
+
+    // Ожидаемое число записей: по одной на каждую пару (остановка маршрута, рейс или интервал)
+    quint64 expectedEntries = 0;
+    quint64 expectedFrequencies = 0;
+    quint64 expectedPostings = 0;
+    for (const auto& schedule : schedules) {
+        const auto stopCount = schedule.getRoute().getStops().size();
+        expectedEntries += stopCount * schedule.getDepartures().size();
+        expectedFrequencies += stopCount * schedule.getFrequencies().size();
+        expectedPostings += stopCount;
+    }
+
+    if (header->stopCount != static_cast<quint32>(allStops.size())
+        || header->scheduleCount != static_cast<quint32>(schedules.size())
+        || header->entryCount != expectedEntries
+        || header->frequencyCount != expectedFrequencies
+        || header->postingCount != expectedPostings
+        || !inBounds<StopRecord>(size, header->stopsOffset, header->stopCount)
+        || !inBounds<DepartureIndex::Entry>(size, header->entriesOffset, header->entryCount)
+        || !inBounds<DepartureIndex::FrequencyRef>(size, header->frequenciesOffset, header->frequencyCount)
+        || !inBounds<StopRouteIndex::Posting>(size, header->postingsOffset, header->postingCount)) {
+        if (errorMessage) *errorMessage = "Index file does not match the schedule: " + file.fileName();
+        return false;
+    }
+
+    const QByteArray payloadHash = QCryptographicHash::hash(
+        QByteArray::fromRawData(reinterpret_cast<const char*>(data + sizeof(Header)),
+                                static_cast<qsizetype>(size - static_cast<qint64>(sizeof(Header)))),
+        QCryptographicHash::Sha1);
+    if (std::memcmp(header->payloadHash, payloadHash.constData(), sizeof(header->payloadHash)) != 0) {
+        if (errorMessage) *errorMessage = "Index file is corrupted: " + file.fileName();
+        return false;
+    }
+
+    const auto* stops = reinterpret_cast<const StopRecord*>(data + header->stopsOffset);
+    const auto* entries = reinterpret_cast<const DepartureIndex::Entry*>(data + header->entriesOffset);
+    const auto* frequencies = reinterpret_cast<const DepartureIndex::FrequencyRef*>(data + header->frequenciesOffset);
+    const auto* postings = reinterpret_cast<const StopRouteIndex::Posting*>(data + header->postingsOffset);
+
+    // Все записи сверяются с расписаниями до загрузки: файл, записанный
+    // другой версией программы или испорченный, не должен дать выход за границы
+    for (quint32 i = 0; i < header->stopCount; ++i) {
+        const StopRecord& stop = stops[i];
+        if (static_cast<quint64>(stop.firstEntry) + stop.entryCount > header->entryCount
+            || static_cast<quint64>(stop.firstFrequency) + stop.frequencyCount > header->frequencyCount
+            || static_cast<quint64>(stop.firstPosting) + stop.postingCount > header->postingCount
+            || !validStop(allStops[static_cast<int>(i)]->getId(), schedules,
+                          {entries + stop.firstEntry, stop.entryCount},
+                          {frequencies + stop.firstFrequency, stop.frequencyCount},
+                          {postings + stop.firstPosting, stop.postingCount})) {
+            if (errorMessage) *errorMessage = "Index file is corrupted: " + file.fileName();
+            return false;
+        }
+    }
+
+    departureIndex.clear();
+    stopRouteIndex.clear();
+    for (quint32 i = 0; i < header->stopCount; ++i) {
+        const StopRecord& stop = stops[i];
+        const StopId stopId = allStops[static_cast<int>(i)]->getId();
+        departureIndex.assignStop(stopId, {entries + stop.firstEntry, stop.entryCount},
+                                  {frequencies + stop.firstFrequency, stop.frequencyCount});
+        stopRouteIndex.assignStop(stopId, {postings + stop.firstPosting, stop.postingCount});
+    }
+
+    qDebug() << "Loaded schedule indexes from" << file.fileName();
+    return true;
+}
@@ -0,0 +1,75 @@
+#ifndef SCHEDULEINDEXFILE_H
+#define SCHEDULEINDEXFILE_H
+
+#include <QString>
+#include <QVector>
+#include <QSharedPointer>
+#include <QtGlobal>
+#include <span>
+#include "DepartureIndex.h"
+#include "StopRouteIndex.h"
+#include "Stop.h"
+#include "Schedule.h"
+
+// Файл индексов рядом с файлом расписания (<файл>.idx): готовые списки
+// DepartureIndex и StopRouteIndex по остановкам, чтобы после перезапуска
+// не строить их заново. Файл помечен размером, временем изменения и SHA-1
+// файла данных; при несовпадении метки индексы строятся заново.
+// Содержимое после заголовка защищено SHA-1, а каждая запись при загрузке
+// сверяется с расписаниями, поэтому поврежденный файл не попадает в индексы.
+// Остановки записываются в порядке allStops - StopId назначаются
+// при каждом запуске и в файл не попадают.
+class ScheduleIndexFile
+{
+public:
+    static constexpr quint32 MAGIC = 0x58444953; // "SIDX"
+    static constexpr quint32 VERSION = 2;
+
+    struct Header {
+        quint32 magic;
+        quint32 version;
+        qint64 dataSize;
+        qint64 dataModified;  // мс от эпохи
+        char dataHash[20];    // SHA-1 содержимого файла данных
+        quint32 stopCount;
+        quint32 scheduleCount;
+        quint32 stopsOffset;
+        quint32 entriesOffset;
+        quint32 entryCount;
+        quint32 frequenciesOffset;
+        quint32 frequencyCount;
+        quint32 postingsOffset;
+        quint32 postingCount;
+        char payloadHash[20]; // SHA-1 всего, что следует за заголовком
+    };
+
+    struct StopRecord {
+        quint32 firstEntry;
+        quint32 entryCount;
+        quint32 firstFrequency;
+        quint32 frequencyCount;
+        quint32 firstPosting;
+        quint32 postingCount;
+    };
+
+    static QString pathFor(const QString& dataFile);
+
+    static bool write(const QString& dataFile, const QVector<QSharedPointer<Stop>>& allStops, int scheduleCount,
+                      const DepartureIndex& departureIndex, const StopRouteIndex& stopRouteIndex,
+                      QString* errorMessage = nullptr);
+
+    // false, если файла нет, он поврежден или метка не совпадает с файлом данных
+    static bool load(const QString& dataFile, const QVector<QSharedPointer<Stop>>& allStops,
+                     const QVector<Schedule>& schedules, DepartureIndex& departureIndex, StopRouteIndex& stopRouteIndex,
+                     QString* errorMessage = nullptr);
+
+private:
+    static bool stampDataFile(const QString& dataFile, Header& header, QString* errorMessage);
+    // Записи остановки должны совпадать с тем, что построил бы DepartureIndex/StopRouteIndex
+    static bool validStop(StopId stopId, const QVector<Schedule>& schedules,
+                          std::span<const DepartureIndex::Entry> entries,
+                          std::span<const DepartureIndex::FrequencyRef> frequencies,
+                          std::span<const StopRouteIndex::Posting> postings);
+};
+
+#endif // SCHEDULEINDEXFILE_H
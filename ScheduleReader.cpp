@@ -1,31 +1,337 @@
 #include "ScheduleReader.h"
+#include <QMultiHash>
+#include <QtConcurrent>
+#include <cstring>
 
 ScheduleReader::ScheduleReader(QObject *parent) : QObject(parent) {}
 
-std::pair<int, int> ScheduleReader::readStartTime(const QString& timeLine) const
+void ScheduleReader::setParserMode(ParserMode mode)
 {
-    QStringList timeParts = timeLine.split(" ");
-    if (timeParts.size() < 2)
+    this->mode = mode;
+}
+
+ScheduleReader::ParserMode ScheduleReader::parserMode() const
+{
+    return mode;
+}
+
+void ScheduleReader::setUtf8(QTextStream& in)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    in.setEncoding(QStringConverter::Utf8);
+#else
+    in.setCodec("UTF-8");
+#endif
+}
+
+QVector<ScheduleReader::BlockRange> ScheduleReader::findScheduleBlocks(ScheduleTokenizer& cursor) const
+{
+    // Быстрый проход по байтам: только поиск строк-маркеров, без разбора содержимого
+    QVector<BlockRange> blocks;
+    while (!cursor.atEnd()) {
+        const std::string_view line = cursor.nextLine();
+        if (line.empty())
+            continue;
+        if (line != "ROUTE_START")
+            cursor.fail("expected ROUTE_START");
+
+        const qsizetype begin = cursor.offset();
+        const int firstLine = cursor.lineNumber();
+        while (cursor.nextLine() != "ROUTE_END") {
+        }
+        blocks.push_back(BlockRange{begin, cursor.offset() - begin, firstLine});
+    }
+    return blocks;
+}
+
+QVector<ScheduleReader::ParsedSchedule> ScheduleReader::parseScheduleBlocks(const QByteArray& data,
+                                                                            const QVector<BlockRange>& blocks) const
+{
+    // Каждый блок разбирается в собственный результат; общих данных между потоками нет
+    auto parseBlock = [this, &data](const BlockRange& block) {
+        try {
+            if (mode == ParserMode::Tokenizer) {
+                ScheduleTokenizer cursor(data.constData() + block.begin, block.length, block.firstLine);
+                return parseScheduleBlock(cursor);
+            }
+
+            QByteArray bytes = QByteArray::fromRawData(data.constData() + block.begin, block.length);
+            QTextStream in(&bytes, QIODevice::ReadOnly);
+            setUtf8(in);
+            return parseScheduleBlock(in);
+        } catch (const FileFormatException& e) {
+            ParsedSchedule failed;
+            failed.errorMessage = mode == ParserMode::Tokenizer
+                ? QString::fromUtf8(e.what())
+                : QString("Schedule at line %1: %2").arg(block.firstLine).arg(e.what());
+            return failed;
+        }
+    };
+
+    return QtConcurrent::blockingMapped<QVector<ParsedSchedule>>(blocks, parseBlock);
+}
+
+ScheduleReader::ParsedSchedule ScheduleReader::parseScheduleBlock(QTextStream& in) const
+{
+    ParsedSchedule parsed = parseSingleSchedule(in);
+
+    // Необязательная секция частотных рейсов перед ROUTE_END
+    QString endLine = in.readLine();
+    if (endLine.startsWith("FREQUENCIES:")) {
+        parsed.frequencies = readFrequencies(in, endLine.mid(12).toInt());
+        endLine = in.readLine();
+    }
+
+    if (parsed.departures.isEmpty() && parsed.frequencies.isEmpty())
+        throw RouteDataException("Invalid route data: no departures");
+
+    if (endLine != "ROUTE_END")
+        throw FileFormatException("Expected ROUTE_END, got: " + endLine);
+
+    return parsed;
+}
+
+ScheduleReader::ParsedSchedule ScheduleReader::parseSingleSchedule(QTextStream& in) const
+{
+    ParsedSchedule parsed;
+
+    // Transport type
+    parsed.transportType = in.readLine();
+    if (parsed.transportType.isNull())
+        throw FileFormatException("Unexpected end of file while reading transport type");
+
+    // Transport ID
+    QString idLine = in.readLine();
+    if (idLine.isNull())
+        throw FileFormatException("Unexpected end of file while reading transport ID");
+    parsed.transportId = idLine.toInt();
+
+    // Departures: "H M" для каждого рейса в одной строке
+    QString timeLine = in.readLine();
+    if (timeLine.isNull())
+        throw FileFormatException("Unexpected end of file while reading time");
+    parsed.departures = readDepartures(timeLine);
+
+    // DAYS:
+    parsed.days = readDays(in);
+
+    // ROUTE_STOPS:
+    int routeStopCount = 0;
+    parsed.routeStopNames = readRouteStopNames(in, routeStopCount);
+
+    // TRAVEL_TIMES:
+    int travelTimeCount = 0;
+    parsed.travelTimes = readTravelTimes(in, travelTimeCount);
+
+    // Validate
+    if (parsed.routeStopNames.size() < 2)
+        throw RouteDataException("Invalid route data: not enough stops");
+    if (parsed.travelTimes.isEmpty())
+        throw RouteDataException("Invalid route data: no travel times");
+
+    return parsed;
+}
+
+ScheduleReader::ParsedSchedule ScheduleReader::parseScheduleBlock(ScheduleTokenizer& cursor) const
+{
+    ParsedSchedule parsed;
+
+    parsed.transportType = cursor.readTextLine();
+    parsed.transportId = cursor.readIntLine();
+
+    // Departures: пары "H M" разбираются прямо в буфере
+    std::string_view timeLine = cursor.nextLine();
+    int hour = 0;
+    int minute = 0;
+    while (cursor.nextInt(timeLine, hour)) {
+        if (!cursor.nextInt(timeLine, minute))
+            throw TimeFormatException(cursor.errorAt("Invalid time format in schedule"));
+        parsed.departures.push_back(TimeTransport(hour, minute));
+    }
+
+    int count = 0;
+    if (cursor.tryReadHeader("DAYS:", count)) {
+        QStringList days;
+        days.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            days.push_back(cursor.readTextLine());
+        }
+        QStringList invalidDays;
+        parsed.days = DayMask::fromStringList(days, &invalidDays);
+        if (!invalidDays.isEmpty())
+            qDebug() << "Skipping unknown days:" << invalidDays;
+    }
+
+    if (cursor.tryReadHeader("ROUTE_STOPS:", count)) {
+        parsed.routeStopNames.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            parsed.routeStopNames.push_back(cursor.readTextLine());
+        }
+    }
+    if (parsed.routeStopNames.size() < 2)
+        throw RouteDataException(cursor.errorAt("Invalid route data: not enough stops"));
+
+    if (cursor.tryReadHeader("TRAVEL_TIMES:", count)) {
+        parsed.travelTimes.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            parsed.travelTimes.push_back(cursor.readIntLine());
+        }
+    }
+    if (parsed.travelTimes.isEmpty())
+        throw RouteDataException(cursor.errorAt("Invalid route data: no travel times"));
+
+    // Необязательная секция частотных рейсов: "H M H M headway"
+    if (cursor.tryReadHeader("FREQUENCIES:", count)) {
+        parsed.frequencies.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            std::string_view line = cursor.nextLine();
+            int values[5];
+            for (int& value : values) {
+                if (!cursor.nextInt(line, value))
+                    throw TimeFormatException(cursor.errorAt("Invalid frequency format"));
+            }
+            int extra = 0;
+            if (cursor.nextInt(line, extra))
+                throw TimeFormatException(cursor.errorAt("Invalid frequency format"));
+
+            FrequencyTrip frequency(TimeTransport(values[0], values[1]), TimeTransport(values[2], values[3]), values[4]);
+            if (!frequency.isValid())
+                throw RouteDataException(cursor.errorAt("Invalid frequency: headway must be positive and start before end"));
+            parsed.frequencies.push_back(frequency);
+        }
+    }
+
+    if (parsed.departures.isEmpty() && parsed.frequencies.isEmpty())
+        throw RouteDataException(cursor.errorAt("Invalid route data: no departures"));
+
+    cursor.expectLine("ROUTE_END");
+    return parsed;
+}
+
+QStringList ScheduleReader::readRouteStopNames(QTextStream& in, int& stopCount) const
+{
+    QString line = in.readLine();
+    if (!line.startsWith("ROUTE_STOPS:"))
+        return {};
+
+    stopCount = line.mid(12).toInt();
+
+    QStringList names;
+    names.reserve(stopCount);
+    for (int i = 0; i < stopCount; ++i) {
+        QString name = in.readLine();
+        if (name.isNull())
+            throw FileFormatException("Unexpected end of file while reading route stop");
+        names.push_back(name);
+    }
+
+    return names;
+}
+
+QVector<TimeTransport> ScheduleReader::readDepartures(const QString& timeLine) const
+{
+    // Пустая строка допустима: у маршрута могут быть только частотные рейсы
+    QStringList timeParts = timeLine.split(" ", Qt::SkipEmptyParts);
+    if (timeParts.size() % 2 != 0)
         throw TimeFormatException("Invalid time format in schedule");
 
-    bool ok1;
-    bool ok2;
-    int hour = timeParts[0].toInt(&ok1);
-    int minute = timeParts[1].toInt(&ok2);
+    QVector<TimeTransport> departures;
+    departures.reserve(timeParts.size() / 2);
+
+    for (int i = 0; i + 1 < timeParts.size(); i += 2) {
+        bool ok1;
+        bool ok2;
+        int hour = timeParts[i].toInt(&ok1);
+        int minute = timeParts[i + 1].toInt(&ok2);
 
-    if (!ok1 || !ok2)
-        throw TimeFormatException("Invalid time values");
+        if (!ok1 || !ok2)
+            throw TimeFormatException("Invalid time values");
+
+        departures.push_back(TimeTransport(hour, minute));
+    }
 
-    return {hour, minute};
+    return departures;
 }
 
-QStringList ScheduleReader::readDays(QTextStream& in) const
+QVector<FrequencyTrip> ScheduleReader::readFrequencies(QTextStream& in, int frequencyCount) const
+{
+    QVector<FrequencyTrip> frequencies;
+    frequencies.reserve(frequencyCount);
+
+    // Формат строки: "H M H M headway" - начало, окончание и интервал в минутах
+    for (int i = 0; i < frequencyCount; ++i) {
+        QString line = in.readLine();
+        if (line.isNull())
+            throw FileFormatException("Unexpected end of file while reading frequency");
+
+        QStringList parts = line.split(" ", Qt::SkipEmptyParts);
+        if (parts.size() != 5)
+            throw TimeFormatException("Invalid frequency format");
+
+        int values[5];
+        for (int j = 0; j < 5; ++j) {
+            bool ok;
+            values[j] = parts[j].toInt(&ok);
+            if (!ok)
+                throw TimeFormatException("Invalid frequency values");
+        }
+
+        FrequencyTrip frequency(TimeTransport(values[0], values[1]), TimeTransport(values[2], values[3]), values[4]);
+        if (!frequency.isValid())
+            throw RouteDataException("Invalid frequency: headway must be positive and start before end");
+
+        frequencies.push_back(frequency);
+    }
+
+    return frequencies;
+}
+
+void ScheduleReader::mergeTripPatterns(QVector<Schedule>& schedules) const
+{
+    // Кандидаты на слияние ищутся только среди маршрутов с тем же номером
+    QMultiHash<int, int> byRouteNumber;
+    QVector<Schedule> merged;
+    merged.reserve(schedules.size());
+
+    for (const auto& schedule : schedules) {
+        const int routeNumber = schedule.getRoute().getRouteNumber();
+        bool found = false;
+
+        const QList<int> candidates = byRouteNumber.values(routeNumber);
+        for (int index : candidates) {
+            Schedule& target = merged[index];
+            if (target.getRoute().hasSamePattern(schedule.getRoute())) {
+                for (const auto& departure : schedule.getDepartures()) {
+                    target.addDeparture(departure);
+                }
+                for (const auto& frequency : schedule.getFrequencies()) {
+                    target.addFrequency(frequency);
+                }
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            byRouteNumber.insert(routeNumber, merged.size());
+            merged.push_back(schedule);
+        }
+    }
+
+    if (merged.size() != schedules.size()) {
+        qDebug() << "Merged" << schedules.size() << "schedules into" << merged.size() << "trip patterns";
+    }
+
+    schedules = std::move(merged);
+}
+
+DayMask ScheduleReader::readDays(QTextStream& in) const
 {
     QStringList days;
     QString line = in.readLine();
 
     if (!line.startsWith("DAYS:"))
-        return days;
+        return DayMask();
 
     int dayCount = line.mid(5).toInt();
     for (int i = 0; i < dayCount; ++i) {
@@ -35,7 +341,12 @@ QStringList ScheduleReader::readDays(QTextStream& in) const
         days.push_back(d);
     }
 
-    return days;
+    QStringList invalidDays;
+    DayMask mask = DayMask::fromStringList(days, &invalidDays);
+    if (!invalidDays.isEmpty())
+        qDebug() << "Skipping unknown days:" << invalidDays;
+
+    return mask;
 }
 
 QVector<int> ScheduleReader::readTravelTimes(QTextStream& in, int& timeCount) const
@@ -76,6 +387,6 @@ void ScheduleReader::addIntermediateStops(Route& route,
         const int timeIndex = stopIndex - firstIntermediateIndex;
         const int travelTime = (timeIndex < travelTimes.size()) ? travelTimes[timeIndex] : 5;
 
-        route.addStop(routeStops[stopIndex], travelTime);
+        route.addStop(routeStops[stopIndex]->getId(), travelTime);
     }
 }
@@ -9,7 +9,10 @@
 #include <functional>
 #include <stdexcept>
 #include <utility>
+#include <optional>
 #include "Schedule.h"
+#include "ScheduleSnapshot.h"
+#include "ScheduleTokenizer.h"
 #include "Stop.h"
 #include "Transport.h"
 #include "TransportType.h"
@@ -46,103 +49,214 @@ public:
         using FileFormatException::FileFormatException;
     };
 
+    // Запись журнала изменений: расписание целиком (замена по шаблону) или удаление по номеру
+    struct JournalRecord {
+        enum class Type { Put, Remove };
+        Type type;
+        int routeNumber;
+        std::optional<Schedule> schedule;
+    };
+
+    // Блок ROUTE_START...ROUTE_END, разобранный без обращения к реестру остановок:
+    // остановки хранятся по именам и разрешаются на этапе слияния
+    struct ParsedSchedule {
+        QString transportType;
+        int transportId = 0;
+        QVector<TimeTransport> departures;
+        QVector<FrequencyTrip> frequencies;
+        DayMask days;
+        QStringList routeStopNames;
+        QVector<int> travelTimes;
+        QString errorMessage;
+    };
+
+    // Разбор блоков маршрутов: построчно через QTextStream или курсором по байтам
+    enum class ParserMode { TextStream, Tokenizer };
+
+    void setParserMode(ParserMode mode);
+    ParserMode parserMode() const;
+
     // Основной метод с шаблонным параметром
-    template<typename StopCreator>
-    ReadResult readFromFile(const QString& filename, StopCreator&& findOrCreateStopCallback) const;
+    template<typename StopResolver>
+    ReadResult readFromFile(const QString& filename, StopResolver&& resolveStopsCallback) const;
+
+    template<typename StopResolver>
+    QVector<JournalRecord> readJournal(const QString& filename, StopResolver&& resolveStopsCallback) const;
 
 private:
+    // Бинарный снимок читается из отображенной в память памяти без разбора текста
+    template<typename StopResolver>
+    ReadResult readFromSnapshot(const QString& filename, StopResolver&& resolveStopsCallback) const;
+
     // Приватные методы также становятся шаблонными
-    template<typename StopCreator>
+    template<typename StopResolver>
     bool readStops(QTextStream& in, int stopCount, QVector<QSharedPointer<Stop>>& allStops,
-                   StopCreator&& findOrCreateStopCallback) const;
+                   StopResolver&& resolveStopsCallback) const;
 
-    template<typename StopCreator>
-    bool readSchedules(QTextStream& in, int scheduleCount, QVector<Schedule>& schedules,
-                       StopCreator&& findOrCreateStopCallback) const;
+    template<typename StopResolver>
+    bool readStops(ScheduleTokenizer& cursor, int stopCount, QVector<QSharedPointer<Stop>>& allStops,
+                   StopResolver&& resolveStopsCallback) const;
 
-    template<typename StopCreator>
-    Schedule readSingleSchedule(QTextStream& in, StopCreator&& findOrCreateStopCallback) const;
+    template<typename StopResolver>
+    void readSchedules(const QByteArray& data, ScheduleTokenizer& cursor, int scheduleCount,
+                       QVector<Schedule>& schedules, StopResolver&& resolveStopsCallback) const;
 
-    QStringList readDays(QTextStream& in) const;
+    template<typename StopResolver>
+    Schedule readScheduleBlock(QTextStream& in, StopResolver&& resolveStopsCallback) const;
 
-    QVector<QSharedPointer<Stop>> readRouteStops(
-        QTextStream& in,
-        int& stopCount,
-        auto&& findOrCreateStopCallback) const;
+    template<typename StopResolver>
+    Schedule buildSchedule(const ParsedSchedule& parsed, StopResolver&& resolveStopsCallback) const;
+
+    // Границы блоков ROUTE_START...ROUTE_END в байтах файла (без строки ROUTE_START)
+    struct BlockRange {
+        qsizetype begin;
+        qsizetype length;
+        int firstLine;
+    };
+
+    QVector<BlockRange> findScheduleBlocks(ScheduleTokenizer& cursor) const;
+    QVector<ParsedSchedule> parseScheduleBlocks(const QByteArray& data, const QVector<BlockRange>& blocks) const;
+
+    ParsedSchedule parseScheduleBlock(QTextStream& in) const;
+    ParsedSchedule parseSingleSchedule(QTextStream& in) const;
+    ParsedSchedule parseScheduleBlock(ScheduleTokenizer& cursor) const;
+
+    DayMask readDays(QTextStream& in) const;
+
+    QStringList readRouteStopNames(QTextStream& in, int& stopCount) const;
 
     QVector<int> readTravelTimes(QTextStream& in, int& timeCount) const;
 
-    std::pair<int, int> readStartTime(const QString& timeLine) const;
+    QVector<TimeTransport> readDepartures(const QString& timeLine) const;
+    QVector<FrequencyTrip> readFrequencies(QTextStream& in, int frequencyCount) const;
+
+    // Объединяет расписания с одинаковым шаблоном маршрута в одно со всеми рейсами
+    void mergeTripPatterns(QVector<Schedule>& schedules) const;
 
     void addIntermediateStops(Route& route, const QVector<QSharedPointer<Stop>>& routeStops,
                                               const QVector<int>& travelTimes) const;
+
+    static void setUtf8(QTextStream& in);
+
+    ParserMode mode = ParserMode::Tokenizer;
 };
 
 // Реализация шаблонных методов прямо в header-файле
-template<typename StopCreator>
-ScheduleReader::ReadResult ScheduleReader::readFromFile(const QString& filename, StopCreator&& findOrCreateStopCallback) const
+template<typename StopResolver>
+ScheduleReader::ReadResult ScheduleReader::readFromFile(const QString& filename, StopResolver&& resolveStopsCallback) const
 {
+    // Формат определяется по сигнатуре файла, а не по расширению
+    if (ScheduleSnapshot::isSnapshotFile(filename)) {
+        return readFromSnapshot(filename, std::forward<StopResolver>(resolveStopsCallback));
+    }
+
     ReadResult result;
     result.success = false;
 
     QFile file(filename);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::ReadOnly)) {
         result.errorMessage = "Cannot open file for reading: " + filename;
         return result;
     }
 
-    QTextStream in(&file);
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-    in.setEncoding(QStringConverter::Utf8);
-#else
-    in.setCodec("UTF-8");
-#endif
-
-    QString line = in.readLine();
-    if (line.isNull()) {
+    // Файл отображается в память целиком; блоки маршрутов разбираются прямо из него
+    const qint64 fileSize = file.size();
+    uchar* mapped = fileSize > 0 ? file.map(0, fileSize) : nullptr;
+    const QByteArray data = mapped
+        ? QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), fileSize)
+        : file.readAll();
+
+    if (data.isEmpty()) {
         result.errorMessage = "File is empty";
-        file.close();
         return result;
     }
 
-    // Read stops
-    if (line.startsWith("STOPS:")) {
-        int stopCount = line.mid(6).toInt();
-        if (!readStops(in, stopCount, result.allStops, std::forward<StopCreator>(findOrCreateStopCallback))) {
+    ScheduleTokenizer cursor(data.constData(), data.size());
+    try {
+        // Read stops
+        int stopCount = 0;
+        if (!cursor.tryReadHeader("STOPS:", stopCount)) {
+            result.errorMessage = "Invalid file format: STOPS section not found";
+            return result;
+        }
+        if (!readStops(cursor, stopCount, result.allStops, std::forward<StopResolver>(resolveStopsCallback))) {
             result.errorMessage = "Error reading stops";
-            file.close();
             return result;
         }
-    } else {
-        result.errorMessage = "Invalid file format: STOPS section not found";
-        file.close();
+
+        // Read schedules
+        int scheduleCount = 0;
+        if (!cursor.tryReadHeader("SCHEDULES:", scheduleCount)) {
+            result.errorMessage = "Invalid file format: SCHEDULES section not found";
+            return result;
+        }
+        readSchedules(data, cursor, scheduleCount, result.schedules, std::forward<StopResolver>(resolveStopsCallback));
+        mergeTripPatterns(result.schedules);
+    } catch (const FileFormatException& e) {
+        result.errorMessage = QString("Error reading schedules: %1").arg(e.what());
+        return result;
+    }
+
+    result.success = true;
+    return result;
+}
+
+template<typename StopResolver>
+ScheduleReader::ReadResult ScheduleReader::readFromSnapshot(const QString& filename, StopResolver&& resolveStopsCallback) const
+{
+    ReadResult result;
+    result.success = false;
+
+    ScheduleSnapshot snapshot;
+    if (!snapshot.open(filename, &result.errorMessage)) {
         return result;
     }
 
-    // Read schedules
-    line = in.readLine();
-    if (line.startsWith("SCHEDULES:")) {
-        int scheduleCount = line.mid(10).toInt();
-        if (!readSchedules(in, scheduleCount, result.schedules, std::forward<StopCreator>(findOrCreateStopCallback))) {
-            result.errorMessage = "Error reading schedules";
-            file.close();
+    // Названия остановок декодируются один раз, маршруты ссылаются на них по индексу
+    QStringList names;
+    QStringList coordinates;
+    names.reserve(snapshot.stopCount());
+    coordinates.reserve(snapshot.stopCount());
+    for (int i = 0; i < snapshot.stopCount(); ++i) {
+        names.push_back(snapshot.stopName(i));
+        coordinates.push_back(snapshot.stopCoordinate(i));
+    }
+    result.allStops = std::forward<StopResolver>(resolveStopsCallback)(names, coordinates);
+    if (result.allStops.size() != snapshot.stopCount()) {
+        result.errorMessage = "Error resolving snapshot stops";
+        return result;
+    }
+
+    QVector<StopId> stopIds;
+    stopIds.reserve(result.allStops.size());
+    for (const auto& stop : result.allStops) {
+        stopIds.push_back(stop->getId());
+    }
+
+    result.schedules.reserve(snapshot.scheduleCount());
+    for (int i = 0; i < snapshot.scheduleCount(); ++i) {
+        auto schedule = snapshot.materialize(i, {stopIds.constData(), static_cast<std::size_t>(stopIds.size())});
+        if (!schedule) {
+            result.errorMessage = QString("Invalid route data in snapshot schedule %1").arg(i);
             return result;
         }
-    } else {
-        result.errorMessage = "Invalid file format: SCHEDULES section not found";
-        file.close();
-        return result;
+        result.schedules.push_back(*schedule);
     }
 
-    file.close();
+    qDebug() << "Loaded binary snapshot" << filename << "with" << result.schedules.size() << "schedules";
     result.success = true;
     return result;
 }
 
-template<typename StopCreator>
+template<typename StopResolver>
 bool ScheduleReader::readStops(QTextStream& in, int stopCount, QVector<QSharedPointer<Stop>>& allStops,
-                               StopCreator&& findOrCreateStopCallback) const
+                               StopResolver&& resolveStopsCallback) const
 {
+    QStringList names;
+    QStringList coordinates;
+    names.reserve(stopCount);
+    coordinates.reserve(stopCount);
+
     for (int i = 0; i < stopCount; ++i) {
         QString name = in.readLine();
         if (name.isNull()) {
@@ -154,118 +268,142 @@ bool ScheduleReader::readStops(QTextStream& in, int stopCount, QVector<QSharedPo
             return false;
         }
 
-        auto stop = std::forward<StopCreator>(findOrCreateStopCallback)(name, coordinate);
-        allStops.push_back(stop);
+        names.push_back(name);
+        coordinates.push_back(coordinate);
     }
+
+    allStops = std::forward<StopResolver>(resolveStopsCallback)(names, coordinates);
     return true;
 }
 
-template<typename StopCreator>
-bool ScheduleReader::readSchedules(QTextStream& in, int scheduleCount, QVector<Schedule>& schedules,
-                                   StopCreator&& findOrCreateStopCallback) const
+template<typename StopResolver>
+bool ScheduleReader::readStops(ScheduleTokenizer& cursor, int stopCount, QVector<QSharedPointer<Stop>>& allStops,
+                               StopResolver&& resolveStopsCallback) const
 {
-    for (int i = 0; i < scheduleCount; ++i) {
-        if (in.readLine() != "ROUTE_START") {
-            return false;
-        }
+    QStringList names;
+    QStringList coordinates;
+    names.reserve(stopCount);
+    coordinates.reserve(stopCount);
 
-        try {
-            Schedule schedule = readSingleSchedule(in, std::forward<StopCreator>(findOrCreateStopCallback));
-            schedules.push_back(schedule);
-        } catch (const FileFormatException& e) {
-            qDebug() << "Error reading schedule:" << e.what();
+    for (int i = 0; i < stopCount; ++i) {
+        if (cursor.atEnd())
             return false;
-        }
+        names.push_back(cursor.readTextLine());
 
-        QString endLine = in.readLine();
-        if (endLine != "ROUTE_END") {
-            qDebug() << "Expected ROUTE_END, got:" << endLine;
+        if (cursor.atEnd())
             return false;
-        }
+        coordinates.push_back(cursor.readTextLine());
     }
+
+    allStops = std::forward<StopResolver>(resolveStopsCallback)(names, coordinates);
     return true;
 }
 
-
-template<typename StopCreator>
-QVector<QSharedPointer<Stop>> ScheduleReader::readRouteStops(
-    QTextStream& in,
-    int& stopCount,
-    StopCreator&& findOrCreateStopCallback) const
+template<typename StopResolver>
+void ScheduleReader::readSchedules(const QByteArray& data, ScheduleTokenizer& cursor, int scheduleCount,
+                                   QVector<Schedule>& schedules, StopResolver&& resolveStopsCallback) const
 {
-    QVector<QSharedPointer<Stop>> stops;
-
-    QString line = in.readLine();
-    if (!line.startsWith("ROUTE_STOPS:"))
-        return stops;
+    const QVector<BlockRange> blocks = findScheduleBlocks(cursor);
+    if (blocks.size() != scheduleCount) {
+        throw FileFormatException(QString("Expected %1 schedules, found %2").arg(scheduleCount).arg(blocks.size()));
+    }
 
-    stopCount = line.mid(12).toInt();
+    // Блоки разбираются параллельно, а остановки разрешаются последовательно:
+    // реестр остановок изменяется при разрешении и общий для всех блоков
+    const QVector<ParsedSchedule> parsed = parseScheduleBlocks(data, blocks);
 
-    for (int i = 0; i < stopCount; ++i) {
-        QString name = in.readLine();
-        if (name.isNull())
-            throw FileFormatException("Unexpected end of file while reading route stop");
-        stops.push_back(findOrCreateStopCallback(name, ""));
+    schedules.reserve(schedules.size() + parsed.size());
+    for (int i = 0; i < parsed.size(); ++i) {
+        if (!parsed[i].errorMessage.isEmpty())
+            throw FileFormatException(parsed[i].errorMessage);
+        try {
+            schedules.push_back(buildSchedule(parsed[i], std::forward<StopResolver>(resolveStopsCallback)));
+        } catch (const FileFormatException& e) {
+            throw FileFormatException(QString("Schedule at line %1: %2").arg(blocks[i].firstLine).arg(e.what()));
+        }
     }
+}
 
-    return stops;
+template<typename StopResolver>
+Schedule ScheduleReader::readScheduleBlock(QTextStream& in, StopResolver&& resolveStopsCallback) const
+{
+    return buildSchedule(parseScheduleBlock(in), std::forward<StopResolver>(resolveStopsCallback));
 }
 
-template<typename StopCreator>
-Schedule ScheduleReader::readSingleSchedule(QTextStream& in, StopCreator&& findOrCreateStopCallback) const
+template<typename StopResolver>
+Schedule ScheduleReader::buildSchedule(const ParsedSchedule& parsed, StopResolver&& resolveStopsCallback) const
 {
-    // Transport type
-    QString transportTypeStr = in.readLine();
-    if (transportTypeStr.isNull())
-        throw FileFormatException("Unexpected end of file while reading transport type");
-
-    // Transport ID
-    QString idLine = in.readLine();
-    if (idLine.isNull())
-        throw FileFormatException("Unexpected end of file while reading transport ID");
-    int transportId = idLine.toInt();
-
-    // Start time
-    QString timeLine = in.readLine();
-    if (timeLine.isNull())
-        throw FileFormatException("Unexpected end of file while reading time");
-    auto[startHour, startMinute] = readStartTime(timeLine);
-
-    TransportType transportType(transportTypeStr);
-    Transport transport(transportType, transportId);
-
-    // DAYS:
-    QStringList days = readDays(in);
-
-    // ROUTE_STOPS:
-    int routeStopCount = 0;
-    QVector<QSharedPointer<Stop>> routeStops =
-        readRouteStops(in, routeStopCount, std::forward<StopCreator>(findOrCreateStopCallback));
-
-    // TRAVEL_TIMES:
-    int travelTimeCount = 0;
-    QVector<int> travelTimes = readTravelTimes(in, travelTimeCount);
+    QVector<QSharedPointer<Stop>> routeStops = resolveStopsCallback(parsed.routeStopNames, QStringList());
 
     // Validate
     if (routeStops.size() < 2)
         throw RouteDataException("Invalid route data: not enough stops");
 
-    // Build route
-    Route route(transport, routeStops[0], routeStops.last());
-    route.setDays(days);
+    Transport transport(TransportType(parsed.transportType), parsed.transportId);
 
-    addIntermediateStops(route, routeStops, travelTimes);
+    // Build route
+    Route route(transport, routeStops[0]->getId(), routeStops.last()->getId());
+    route.setDays(parsed.days);
 
-    if (!travelTimes.isEmpty())
-        route.addFinalTravelTime(travelTimes.last());
+    addIntermediateStops(route, routeStops, parsed.travelTimes);
 
-    TimeTransport startTime(startHour, startMinute);
-    route.calculateArrivalTimes(startTime);
+    route.addFinalTravelTime(parsed.travelTimes.last());
 
-    return Schedule(route, startTime);
+    Schedule schedule(route, parsed.departures);
+    schedule.setFrequencies(parsed.frequencies);
+    return schedule;
 }
 
+template<typename StopResolver>
+QVector<ScheduleReader::JournalRecord> ScheduleReader::readJournal(const QString& filename,
+                                                                  StopResolver&& resolveStopsCallback) const
+{
+    QVector<JournalRecord> records;
+
+    QFile file(filename);
+    if (!file.exists())
+        return records;
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qDebug() << "Cannot open journal for reading:" << filename;
+        return records;
+    }
+
+    QTextStream in(&file);
+    setUtf8(in);
+
+    // Оборванная последняя запись (сбой во время дозаписи) отбрасывается
+    while (!in.atEnd()) {
+        const QString line = in.readLine();
+        try {
+            if (line == "JOURNAL_PUT") {
+                const QString stopsLine = in.readLine();
+                QVector<QSharedPointer<Stop>> stops;
+                if (!stopsLine.startsWith("STOPS:")
+                    || !readStops(in, stopsLine.mid(6).toInt(), stops, std::forward<StopResolver>(resolveStopsCallback)))
+                    throw FileFormatException("Invalid journal stops");
+                if (in.readLine() != "ROUTE_START")
+                    throw FileFormatException("Expected ROUTE_START in journal");
+
+                Schedule schedule = readScheduleBlock(in, std::forward<StopResolver>(resolveStopsCallback));
+                records.push_back(JournalRecord{JournalRecord::Type::Put,
+                                                schedule.getRoute().getRouteNumber(), schedule});
+            } else if (line.startsWith("JOURNAL_REMOVE:")) {
+                bool ok;
+                const int routeNumber = line.mid(15).toInt(&ok);
+                if (!ok)
+                    throw FileFormatException("Invalid journal route number");
+                records.push_back(JournalRecord{JournalRecord::Type::Remove, routeNumber, std::nullopt});
+            } else if (!line.isEmpty()) {
+                throw FileFormatException("Unknown journal record: " + line);
+            }
+        } catch (const FileFormatException& e) {
+            qDebug() << "Journal" << filename << "truncated after" << records.size() << "records:" << e.what();
+            break;
+        }
+    }
 
+    return records;
+}
 
 
 #endif // SCHEDULEREADER_H
@@ -0,0 +1,382 @@
+#include "ScheduleSnapshot.h"
+#include "StopRegistry.h"
+#include "TransportType.h"
+#include <QByteArray>
+#include <QSaveFile>
+#include <QHash>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+constexpr quint32 ALIGNMENT = 4;
+
+quint32 alignedSize(qsizetype size)
+{
+    return static_cast<quint32>((size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+}
+
+template<typename T>
+quint32 appendArray(QByteArray& buffer, const QVector<T>& values)
+{
+    buffer.resize(alignedSize(buffer.size()));
+    const auto offset = static_cast<quint32>(buffer.size());
+    buffer.append(reinterpret_cast<const char*>(values.constData()),
+                  static_cast<qsizetype>(values.size() * sizeof(T)));
+    return offset;
+}
+
+static_assert(sizeof(ScheduleSnapshot::Header) == 64, "Snapshot header layout changed");
+static_assert(sizeof(ScheduleSnapshot::StopRecord) == 16, "Snapshot stop record layout changed");
+static_assert(sizeof(ScheduleSnapshot::ScheduleRecord) == 40, "Snapshot schedule record layout changed");
+static_assert(sizeof(ScheduleSnapshot::FrequencyRecord) == 8, "Snapshot frequency record layout changed");
+
+bool inBounds(quint64 offset, quint64 count, quint64 elementSize, quint64 limit)
+{
+    return offset % ALIGNMENT == 0 && offset <= limit && count <= (limit - offset) / elementSize;
+}
+}
+
+ScheduleSnapshot::~ScheduleSnapshot()
+{
+    close();
+}
+
+bool ScheduleSnapshot::isSnapshotFile(const QString& filename)
+{
+    QFile probe(filename);
+    if (!probe.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    quint32 magic = 0;
+    if (probe.read(reinterpret_cast<char*>(&magic), sizeof(magic)) != sizeof(magic)) {
+        return false;
+    }
+    return qFromLittleEndian(magic) == MAGIC;
+}
+
+bool ScheduleSnapshot::write(const QString& filename, const QVector<Schedule>& schedules,
+                             const QVector<QSharedPointer<Stop>>& allStops, QString* errorMessage)
+{
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    if (errorMessage) *errorMessage = "Binary snapshots are only supported on little-endian hosts";
+    return false;
+#endif
+
+    QByteArray strings;
+    auto addString = [&strings](const QString& text) {
+        const QByteArray utf8 = text.toUtf8();
+        StringRef ref{static_cast<quint32>(strings.size()), static_cast<quint32>(utf8.size())};
+        strings.append(utf8);
+        return ref;
+    };
+
+    // Таблица остановок снимка: позиции совпадают с allStops
+    QVector<StopRecord> stops;
+    QHash<StopId, quint32> stopIndexById;
+    stops.reserve(allStops.size());
+    for (const auto& stop : allStops) {
+        stopIndexById.insert(stop->getId(), static_cast<quint32>(stops.size()));
+        stops.push_back(StopRecord{addString(stop->getName()), addString(stop->getCoordinate())});
+    }
+
+    auto stopIndexFor = [&](StopId stopId) {
+        auto it = stopIndexById.constFind(stopId);
+        if (it != stopIndexById.constEnd()) {
+            return it.value();
+        }
+        // Остановка маршрута без записи в allStops - добавляем без координат
+        const auto index = static_cast<quint32>(stops.size());
+        stopIndexById.insert(stopId, index);
+        stops.push_back(StopRecord{addString(StopRegistry::instance().name(stopId)), addString(QString())});
+        return index;
+    };
+
+    QVector<ScheduleRecord> records;
+    QVector<quint32> routeStops;
+    QVector<qint32> travelTimes;
+    QVector<quint16> departures;
+    QVector<FrequencyRecord> frequencies;
+    records.reserve(schedules.size());
+
+    for (const auto& schedule : schedules) {
+        const auto& route = schedule.getRoute();
+        ScheduleRecord record{};
+        record.routeNumber = route.getRouteNumber();
+        record.transportType = static_cast<quint8>(route.getTransport().getType().getType());
+        record.days = route.getDays().toBits();
+
+        record.firstRouteStop = static_cast<quint32>(routeStops.size());
+        for (const auto& routeStop : route.getStops()) {
+            routeStops.push_back(stopIndexFor(routeStop.stopId));
+        }
+        record.routeStopCount = static_cast<quint32>(routeStops.size()) - record.firstRouteStop;
+
+        record.firstTravelTime = static_cast<quint32>(travelTimes.size());
+        for (int travelTime : route.getTravelTimes()) {
+            travelTimes.push_back(travelTime);
+        }
+        record.travelTimeCount = static_cast<quint32>(travelTimes.size()) - record.firstTravelTime;
+
+        record.firstDeparture = static_cast<quint32>(departures.size());
+        for (const auto& departure : schedule.getDepartures()) {
+            departures.push_back(static_cast<quint16>(departure.toMinutes()));
+        }
+        record.departureCount = static_cast<quint32>(departures.size()) - record.firstDeparture;
+
+        record.firstFrequency = static_cast<quint32>(frequencies.size());
+        for (const auto& frequency : schedule.getFrequencies()) {
+            frequencies.push_back(FrequencyRecord{static_cast<quint16>(frequency.getStart().toMinutes()),
+                                                  static_cast<quint16>(frequency.getEnd().toMinutes()),
+                                                  static_cast<quint16>(frequency.getHeadway()), 0});
+        }
+        record.frequencyCount = static_cast<quint32>(frequencies.size()) - record.firstFrequency;
+
+        records.push_back(record);
+    }
+
+    Header header{};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.stopCount = static_cast<quint32>(stops.size());
+    header.scheduleCount = static_cast<quint32>(records.size());
+    header.routeStopCount = static_cast<quint32>(routeStops.size());
+    header.travelTimeCount = static_cast<quint32>(travelTimes.size());
+    header.departureCount = static_cast<quint32>(departures.size());
+    header.frequencyCount = static_cast<quint32>(frequencies.size());
+
+    QByteArray buffer(sizeof(Header), '\0');
+    header.stopsOffset = appendArray(buffer, stops);
+    header.schedulesOffset = appendArray(buffer, records);
+    header.routeStopsOffset = appendArray(buffer, routeStops);
+    header.travelTimesOffset = appendArray(buffer, travelTimes);
+    header.departuresOffset = appendArray(buffer, departures);
+    header.frequenciesOffset = appendArray(buffer, frequencies);
+    buffer.resize(alignedSize(buffer.size()));
+    header.stringsOffset = static_cast<quint32>(buffer.size());
+    header.stringsSize = static_cast<quint32>(strings.size());
+    buffer.append(strings);
+    std::memcpy(buffer.data(), &header, sizeof(Header));
+
+    // Временный файл с атомарной заменой: открытые отображения старого снимка не затрагиваются
+    QSaveFile out(filename);
+    if (!out.open(QIODevice::WriteOnly) || out.write(buffer) != buffer.size() || !out.commit()) {
+        if (errorMessage) *errorMessage = "Cannot write snapshot: " + filename;
+        return false;
+    }
+
+    qDebug() << "Wrote binary snapshot" << filename << "(" << buffer.size() << "bytes)";
+    return true;
+}
+
+bool ScheduleSnapshot::open(const QString& filename, QString* errorMessage)
+{
+    close();
+
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    if (errorMessage) *errorMessage = "Binary snapshots are only supported on little-endian hosts";
+    return false;
+#endif
+
+    file.setFileName(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage) *errorMessage = "Cannot open snapshot for reading: " + filename;
+        return false;
+    }
+
+    size = file.size();
+    if (size < static_cast<qint64>(sizeof(Header))) {
+        if (errorMessage) *errorMessage = "Snapshot is truncated: " + filename;
+        close();
+        return false;
+    }
+
+    data = file.map(0, size);
+    if (!data) {
+        if (errorMessage) *errorMessage = "Cannot map snapshot into memory: " + filename;
+        close();
+        return false;
+    }
+
+    header = at<Header>(0);
+    if (!validate(errorMessage)) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void ScheduleSnapshot::close()
+{
+    if (data) {
+        file.unmap(const_cast<uchar*>(data));
+    }
+    if (file.isOpen()) {
+        file.close();
+    }
+    data = nullptr;
+    header = nullptr;
+    size = 0;
+}
+
+bool ScheduleSnapshot::isOpen() const
+{
+    return header != nullptr;
+}
+
+bool ScheduleSnapshot::validate(QString* errorMessage) const
+{
+    auto fail = [errorMessage](const QString& message) {
+        if (errorMessage) *errorMessage = message;
+        return false;
+    };
+
+    if (header->magic != MAGIC) {
+        return fail("Not a schedule snapshot");
+    }
+    if (header->version != VERSION) {
+        return fail(QString("Unsupported snapshot version: %1").arg(header->version));
+    }
+
+    // Проверяем границы один раз при открытии, чтобы дальше читать без проверок
+    const auto limit = static_cast<quint64>(size);
+    if (!inBounds(header->stopsOffset, header->stopCount, sizeof(StopRecord), limit)
+        || !inBounds(header->schedulesOffset, header->scheduleCount, sizeof(ScheduleRecord), limit)
+        || !inBounds(header->routeStopsOffset, header->routeStopCount, sizeof(quint32), limit)
+        || !inBounds(header->travelTimesOffset, header->travelTimeCount, sizeof(qint32), limit)
+        || !inBounds(header->departuresOffset, header->departureCount, sizeof(quint16), limit)
+        || !inBounds(header->frequenciesOffset, header->frequencyCount, sizeof(FrequencyRecord), limit)
+        || !inBounds(header->stringsOffset, header->stringsSize, 1, limit)) {
+        return fail("Snapshot section is out of bounds");
+    }
+
+    auto stringOk = [this](const StringRef& ref) {
+        return ref.offset <= header->stringsSize && ref.length <= header->stringsSize - ref.offset;
+    };
+    const auto* stops = at<StopRecord>(header->stopsOffset);
+    for (quint32 i = 0; i < header->stopCount; ++i) {
+        if (!stringOk(stops[i].name) || !stringOk(stops[i].coordinate)) {
+            return fail("Snapshot stop name is out of bounds");
+        }
+    }
+
+    auto rangeOk = [](quint32 first, quint32 count, quint32 total) {
+        return first <= total && count <= total - first;
+    };
+    const auto* records = at<ScheduleRecord>(header->schedulesOffset);
+    const auto* routeStopIndices = at<quint32>(header->routeStopsOffset);
+    for (quint32 i = 0; i < header->scheduleCount; ++i) {
+        const auto& r = records[i];
+        if (!rangeOk(r.firstRouteStop, r.routeStopCount, header->routeStopCount)
+            || !rangeOk(r.firstTravelTime, r.travelTimeCount, header->travelTimeCount)
+            || !rangeOk(r.firstDeparture, r.departureCount, header->departureCount)
+            || !rangeOk(r.firstFrequency, r.frequencyCount, header->frequencyCount)
+            || r.transportType > static_cast<quint8>(TransportType::Type::TRAM)) {
+            return fail(QString("Snapshot schedule %1 is out of bounds").arg(i));
+        }
+        // Между соседними остановками ровно одно время в пути
+        if (r.routeStopCount < 2 || r.travelTimeCount != r.routeStopCount - 1) {
+            return fail(QString("Snapshot schedule %1 has %2 travel times for %3 stops")
+                            .arg(i).arg(r.travelTimeCount).arg(r.routeStopCount));
+        }
+    }
+    for (quint32 i = 0; i < header->routeStopCount; ++i) {
+        if (routeStopIndices[i] >= header->stopCount) {
+            return fail("Snapshot route references an unknown stop");
+        }
+    }
+
+    return true;
+}
+
+int ScheduleSnapshot::stopCount() const
+{
+    return header ? static_cast<int>(header->stopCount) : 0;
+}
+
+QString ScheduleSnapshot::string(const StringRef& ref) const
+{
+    return QString::fromUtf8(reinterpret_cast<const char*>(data + header->stringsOffset + ref.offset),
+                             static_cast<qsizetype>(ref.length));
+}
+
+QString ScheduleSnapshot::stopName(int stopIndex) const
+{
+    return string(at<StopRecord>(header->stopsOffset)[stopIndex].name);
+}
+
+QString ScheduleSnapshot::stopCoordinate(int stopIndex) const
+{
+    return string(at<StopRecord>(header->stopsOffset)[stopIndex].coordinate);
+}
+
+int ScheduleSnapshot::scheduleCount() const
+{
+    return header ? static_cast<int>(header->scheduleCount) : 0;
+}
+
+const ScheduleSnapshot::ScheduleRecord& ScheduleSnapshot::scheduleRecord(int scheduleIndex) const
+{
+    return at<ScheduleRecord>(header->schedulesOffset)[scheduleIndex];
+}
+
+std::span<const quint32> ScheduleSnapshot::routeStops(int scheduleIndex) const
+{
+    const auto& r = scheduleRecord(scheduleIndex);
+    return {at<quint32>(header->routeStopsOffset) + r.firstRouteStop, r.routeStopCount};
+}
+
+std::span<const qint32> ScheduleSnapshot::travelTimes(int scheduleIndex) const
+{
+    const auto& r = scheduleRecord(scheduleIndex);
+    return {at<qint32>(header->travelTimesOffset) + r.firstTravelTime, r.travelTimeCount};
+}
+
+std::span<const quint16> ScheduleSnapshot::departures(int scheduleIndex) const
+{
+    const auto& r = scheduleRecord(scheduleIndex);
+    return {at<quint16>(header->departuresOffset) + r.firstDeparture, r.departureCount};
+}
+
+std::span<const ScheduleSnapshot::FrequencyRecord> ScheduleSnapshot::frequencies(int scheduleIndex) const
+{
+    const auto& r = scheduleRecord(scheduleIndex);
+    return {at<FrequencyRecord>(header->frequenciesOffset) + r.firstFrequency, r.frequencyCount};
+}
+
+std::optional<Schedule> ScheduleSnapshot::materialize(int scheduleIndex, std::span<const StopId> stopIds) const
+{
+    const auto& record = scheduleRecord(scheduleIndex);
+    const auto stops = routeStops(scheduleIndex);
+    const auto times = travelTimes(scheduleIndex);
+    if (stops.size() < 2 || times.empty()) {
+        return std::nullopt;
+    }
+
+    Transport transport(TransportType(static_cast<TransportType::Type>(record.transportType)), record.routeNumber);
+    Route route(transport, stopIds[stops.front()], stopIds[stops.back()]);
+    route.setDays(DayMask(record.days));
+    for (std::size_t s = 1; s + 1 < stops.size(); ++s) {
+        route.addStop(stopIds[stops[s]], times[s - 1]);
+    }
+    route.addFinalTravelTime(times.back());
+
+    QVector<TimeTransport> departureTimes;
+    departureTimes.reserve(static_cast<qsizetype>(departures(scheduleIndex).size()));
+    for (quint16 minutes : departures(scheduleIndex)) {
+        departureTimes.push_back(TimeTransport(0, minutes));
+    }
+
+    QVector<FrequencyTrip> frequencyTrips;
+    for (const auto& frequency : frequencies(scheduleIndex)) {
+        frequencyTrips.push_back(FrequencyTrip(TimeTransport(0, frequency.startMinute),
+                                               TimeTransport(0, frequency.endMinute),
+                                               frequency.headway));
+    }
+
+    Schedule schedule(route, departureTimes);
+    schedule.setFrequencies(frequencyTrips);
+    return schedule;
+}
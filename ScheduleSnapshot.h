@@ -0,0 +1,119 @@
+#ifndef SCHEDULESNAPSHOT_H
+#define SCHEDULESNAPSHOT_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QSharedPointer>
+#include <QtGlobal>
+#include <optional>
+#include <span>
+#include "Schedule.h"
+#include "Stop.h"
+
+// Бинарный снимок расписания (transport_schedule.bin).
+// Файл отображается в память через QFile::map и читается на месте:
+// заголовок, таблица остановок, записи расписаний фиксированной ширины,
+// плоские массивы остановок маршрутов, времен движения, отправлений и
+// частотных интервалов, затем таблица строк UTF-8. Все смещения - от начала
+// файла, все числа - little-endian, массивы выровнены на 4 байта.
+class ScheduleSnapshot
+{
+public:
+    static constexpr quint32 MAGIC = 0x50414E53; // "SNAP"
+    static constexpr quint32 VERSION = 1;
+
+    struct Header {
+        quint32 magic;
+        quint32 version;
+        quint32 stopCount;
+        quint32 scheduleCount;
+        quint32 stopsOffset;
+        quint32 schedulesOffset;
+        quint32 routeStopsOffset;
+        quint32 routeStopCount;
+        quint32 travelTimesOffset;
+        quint32 travelTimeCount;
+        quint32 departuresOffset;
+        quint32 departureCount;
+        quint32 frequenciesOffset;
+        quint32 frequencyCount;
+        quint32 stringsOffset;
+        quint32 stringsSize;
+    };
+
+    struct StringRef {
+        quint32 offset; // относительно начала таблицы строк
+        quint32 length; // в байтах UTF-8
+    };
+
+    struct StopRecord {
+        StringRef name;
+        StringRef coordinate;
+    };
+
+    struct ScheduleRecord {
+        qint32 routeNumber;
+        quint8 transportType;
+        quint8 days;
+        quint16 reserved;
+        quint32 firstRouteStop;  // индексы в таблице остановок снимка
+        quint32 routeStopCount;
+        quint32 firstTravelTime;
+        quint32 travelTimeCount;
+        quint32 firstDeparture;  // минуты от полуночи
+        quint32 departureCount;
+        quint32 firstFrequency;
+        quint32 frequencyCount;
+    };
+
+    struct FrequencyRecord {
+        quint16 startMinute;
+        quint16 endMinute;
+        quint16 headway;
+        quint16 reserved;
+    };
+
+    ScheduleSnapshot() = default;
+    ~ScheduleSnapshot();
+    ScheduleSnapshot(const ScheduleSnapshot&) = delete;
+    ScheduleSnapshot& operator=(const ScheduleSnapshot&) = delete;
+
+    static bool isSnapshotFile(const QString& filename);
+    static bool write(const QString& filename, const QVector<Schedule>& schedules,
+                      const QVector<QSharedPointer<Stop>>& allStops, QString* errorMessage = nullptr);
+
+    bool open(const QString& filename, QString* errorMessage = nullptr);
+    void close();
+    bool isOpen() const;
+
+    int stopCount() const;
+    QString stopName(int stopIndex) const;
+    QString stopCoordinate(int stopIndex) const;
+
+    int scheduleCount() const;
+    const ScheduleRecord& scheduleRecord(int scheduleIndex) const;
+    std::span<const quint32> routeStops(int scheduleIndex) const;
+    std::span<const qint32> travelTimes(int scheduleIndex) const;
+    std::span<const quint16> departures(int scheduleIndex) const;
+    std::span<const FrequencyRecord> frequencies(int scheduleIndex) const;
+
+    // Сборка Schedule из записи; stopIds сопоставляет остановкам снимка StopId.
+    // nullopt для некорректной записи (меньше двух остановок или нет времен движения)
+    std::optional<Schedule> materialize(int scheduleIndex, std::span<const StopId> stopIds) const;
+
+private:
+    template<typename T>
+    const T* at(quint32 offset) const {
+        return reinterpret_cast<const T*>(data + offset);
+    }
+    QString string(const StringRef& ref) const;
+    bool validate(QString* errorMessage) const;
+
+    QFile file;
+    const uchar* data = nullptr;
+    qint64 size = 0;
+    const Header* header = nullptr;
+};
+
+#endif // SCHEDULESNAPSHOT_H
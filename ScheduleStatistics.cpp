@@ -0,0 +1,90 @@
+#include "ScheduleStatistics.h"
+#include <utility>
+
+void ScheduleStatistics::build(const QVector<Schedule>& schedules)
+{
+    clear();
+    for (const auto& schedule : schedules) {
+        addSchedule(schedule);
+    }
+}
+
+void ScheduleStatistics::clear()
+{
+    routes = 0;
+    trips = 0;
+    routeStops = 0;
+    routesByType.fill(0);
+    tripsByDay.fill(0);
+    routesByStopCount.clear();
+}
+
+void ScheduleStatistics::addSchedule(const Schedule& schedule)
+{
+    apply(schedule, 1);
+}
+
+void ScheduleStatistics::removeSchedule(const Schedule& schedule)
+{
+    apply(schedule, -1);
+}
+
+void ScheduleStatistics::apply(const Schedule& schedule, int sign)
+{
+    const auto& route = schedule.getRoute();
+    const int tripCount = schedule.getTripCount();
+    const int stopCount = static_cast<int>(route.getStops().size());
+
+    routes += sign;
+    trips += sign * tripCount;
+    routeStops += sign * stopCount;
+    routesByType[std::to_underlying(route.getTransport().getType().getType())] += sign;
+
+    const auto days = route.getDays();
+    for (int day = 1; day <= DayMask::DAYS_IN_WEEK; ++day) {
+        if (days.contains(day)) {
+            tripsByDay[day - 1] += sign * tripCount;
+        }
+    }
+
+    int& sameLength = routesByStopCount[stopCount];
+    sameLength += sign;
+    if (sameLength <= 0) {
+        routesByStopCount.remove(stopCount);
+    }
+}
+
+int ScheduleStatistics::routeCount() const
+{
+    return routes;
+}
+
+int ScheduleStatistics::tripCount() const
+{
+    return trips;
+}
+
+int ScheduleStatistics::routeCount(TransportType::Type type) const
+{
+    return routesByType[std::to_underlying(type)];
+}
+
+int ScheduleStatistics::tripsOnDay(int dayOfWeek) const
+{
+    return dayOfWeek >= 1 && dayOfWeek <= DayMask::DAYS_IN_WEEK ? tripsByDay[dayOfWeek - 1] : 0;
+}
+
+int ScheduleStatistics::minStopsPerRoute() const
+{
+    return routesByStopCount.isEmpty() ? 0 : routesByStopCount.firstKey();
+}
+
+int ScheduleStatistics::maxStopsPerRoute() const
+{
+    return routesByStopCount.isEmpty() ? 0 : routesByStopCount.lastKey();
+}
+
+double ScheduleStatistics::averageStopsPerRoute() const
+{
+    return routes > 0 ? static_cast<double>(routeStops) / routes : 0;
+}
@@ -0,0 +1,48 @@
+#ifndef SCHEDULESTATISTICS_H
+#define SCHEDULESTATISTICS_H
+
+#include <QVector>
+#include <QMap>
+#include <array>
+#include "Schedule.h"
+#include "TransportType.h"
+#include "DayMask.h"
+
+// Накопительная статистика по расписаниям: обновляется при добавлении
+// и удалении расписания (изменяемое расписание удаляется и добавляется заново),
+// поэтому чтение не требует обхода всех маршрутов.
+// Статистика по остановкам ведется в StopUsageIndex.
+class ScheduleStatistics
+{
+public:
+    static constexpr int TRANSPORT_TYPE_COUNT = 3;
+
+    void build(const QVector<Schedule>& schedules);
+    void clear();
+
+    void addSchedule(const Schedule& schedule);
+    void removeSchedule(const Schedule& schedule);
+
+    int routeCount() const;
+    int tripCount() const;
+    int routeCount(TransportType::Type type) const;
+    // Рейсы за день недели (1 - понедельник)
+    int tripsOnDay(int dayOfWeek) const;
+
+    int minStopsPerRoute() const;
+    int maxStopsPerRoute() const;
+    double averageStopsPerRoute() const;
+
+private:
+    void apply(const Schedule& schedule, int sign);
+
+    int routes = 0;
+    int trips = 0;
+    qint64 routeStops = 0;
+    std::array<int, TRANSPORT_TYPE_COUNT> routesByType{};
+    std::array<int, DayMask::DAYS_IN_WEEK> tripsByDay{};
+    // Число остановок маршрута -> количество таких маршрутов (для минимума и максимума)
+    QMap<int, int> routesByStopCount;
+};
+
+#endif // SCHEDULESTATISTICS_H
@@ -0,0 +1,125 @@
+#include "ScheduleTokenizer.h"
+#include "ScheduleReader.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+ScheduleTokenizer::ScheduleTokenizer(const char* data, qsizetype size, int firstLineNumber)
+    : data(data), size(size), currentLine(firstLineNumber)
+{
+}
+
+bool ScheduleTokenizer::atEnd() const
+{
+    return position >= size;
+}
+
+qsizetype ScheduleTokenizer::offset() const
+{
+    return position;
+}
+
+int ScheduleTokenizer::lineNumber() const
+{
+    return currentLine;
+}
+
+std::string_view ScheduleTokenizer::nextLine()
+{
+    if (atEnd()) {
+        throw ScheduleReader::FileFormatException(
+            QString("Line %1: unexpected end of file").arg(currentLine));
+    }
+
+    const char* begin = data + position;
+    const void* newline = std::memchr(begin, '\n', size - position);
+    const char* end = newline ? static_cast<const char*>(newline) : data + size;
+    position = (end - data) + (newline ? 1 : 0);
+    ++currentLine;
+
+    if (end > begin && end[-1] == '\r')
+        --end;
+    return std::string_view(begin, end - begin);
+}
+
+bool ScheduleTokenizer::tryReadHeader(std::string_view prefix, int& value)
+{
+    if (atEnd())
+        return false;
+
+    // Проверяем префикс до чтения строки, чтобы не сдвигать курсор
+    const qsizetype available = size - position;
+    if (available < static_cast<qsizetype>(prefix.size())
+        || std::memcmp(data + position, prefix.data(), prefix.size()) != 0)
+        return false;
+
+    const std::string_view line = nextLine();
+    if (!parseInt(line.substr(prefix.size()), value))
+        fail(QString("invalid count in %1").arg(QString::fromUtf8(prefix.data(), prefix.size())));
+    return true;
+}
+
+int ScheduleTokenizer::readIntLine()
+{
+    int value = 0;
+    if (!parseInt(nextLine(), value))
+        fail("invalid integer value");
+    return value;
+}
+
+QString ScheduleTokenizer::readTextLine()
+{
+    const std::string_view line = nextLine();
+    return QString::fromUtf8(line.data(), static_cast<qsizetype>(line.size()));
+}
+
+void ScheduleTokenizer::expectLine(std::string_view expected)
+{
+    const std::string_view line = nextLine();
+    if (line != expected) {
+        fail(QString("expected %1, got: %2")
+                 .arg(QString::fromUtf8(expected.data(), expected.size()),
+                      QString::fromUtf8(line.data(), static_cast<qsizetype>(line.size()))));
+    }
+}
+
+bool ScheduleTokenizer::nextInt(std::string_view& line, int& value) const
+{
+    const auto start = line.find_first_not_of(' ');
+    if (start == std::string_view::npos) {
+        line = {};
+        return false;
+    }
+    line.remove_prefix(start);
+
+    const auto end = std::min(line.find(' '), line.size());
+    if (!parseInt(line.substr(0, end), value))
+        fail("invalid integer value");
+    line.remove_prefix(end);
+    return true;
+}
+
+QString ScheduleTokenizer::errorAt(const QString& message) const
+{
+    return QString("Line %1: %2").arg(currentLine - 1).arg(message);
+}
+
+void ScheduleTokenizer::fail(const QString& message) const
+{
+    throw ScheduleReader::FileFormatException(errorAt(message));
+}
+
+bool ScheduleTokenizer::parseInt(std::string_view text, int& value)
+{
+    // Как QString::toInt: допускаются пробелы по краям, но не мусор после числа
+    while (!text.empty() && text.front() == ' ')
+        text.remove_prefix(1);
+    while (!text.empty() && text.back() == ' ')
+        text.remove_suffix(1);
+    if (!text.empty() && text.front() == '+')
+        text.remove_prefix(1);
+
+    const char* end = text.data() + text.size();
+    const auto [ptr, ec] = std::from_chars(text.data(), end, value);
+    return !text.empty() && ec == std::errc() && ptr == end;
+}
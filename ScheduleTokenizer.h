@@ -0,0 +1,49 @@
+#ifndef SCHEDULETOKENIZER_H
+#define SCHEDULETOKENIZER_H
+
+#include <QString>
+#include <QtGlobal>
+#include <string_view>
+
+// Курсор по строкам текстового расписания в памяти (обычно отображенной через
+// QFile::map). Строки возвращаются как std::string_view на исходный буфер,
+// числа и заголовки секций разбираются на месте - в UTF-16 декодируются только
+// названия. Ошибки бросаются как ScheduleReader::FileFormatException с номером строки.
+class ScheduleTokenizer
+{
+public:
+    ScheduleTokenizer(const char* data, qsizetype size, int firstLineNumber = 1);
+
+    bool atEnd() const;
+    qsizetype offset() const;
+    // Номер строки, которая будет прочитана следующей
+    int lineNumber() const;
+
+    // Следующая строка без "\n" и "\r"; в конце буфера - исключение
+    std::string_view nextLine();
+
+    // Заголовок вида "PREFIX:<число>"; если строка начинается иначе, она не читается
+    bool tryReadHeader(std::string_view prefix, int& value);
+
+    int readIntLine();
+    QString readTextLine();
+    void expectLine(std::string_view expected);
+
+    // Очередное целое из строки через пробелы; line сдвигается за него.
+    // Возвращает false, если чисел в строке больше нет
+    bool nextInt(std::string_view& line, int& value) const;
+
+    // Сообщение с номером только что прочитанной строки
+    QString errorAt(const QString& message) const;
+    [[noreturn]] void fail(const QString& message) const;
+
+private:
+    static bool parseInt(std::string_view text, int& value);
+
+    const char* data;
+    qsizetype size;
+    qsizetype position = 0;
+    int currentLine;
+};
+
+#endif // SCHEDULETOKENIZER_H
@@ -2,31 +2,138 @@
 #include "Transport.h"
 #include "TransportType.h"
 #include "TimeTransport.h"
+#include "ScheduleSnapshot.h"
 #include <QDebug>
+#include <QSaveFile>
 
 ScheduleWriter::ScheduleWriter(QObject *parent) : QObject(parent) {}
 
 bool ScheduleWriter::writeToFile(const QString& filename, const QVector<Schedule>& schedules, const QVector<QSharedPointer<Stop>>& allStops) const
 {
-    QFile file(filename);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    // Файлы .bin сохраняются бинарным снимком, остальные - текстовым форматом
+    if (filename.endsWith(".bin", Qt::CaseInsensitive)) {
+        QString errorMessage;
+        if (!ScheduleSnapshot::write(filename, schedules, allStops, &errorMessage)) {
+            qDebug() << errorMessage;
+            return false;
+        }
+        return true;
+    }
+
+    return writeTextFile(filename, schedules, allStops);
+}
+
+bool ScheduleWriter::writeTextFile(const QString& filename, const QVector<Schedule>& schedules,
+                                   const QVector<QSharedPointer<Stop>>& allStops) const
+{
+    // Запись идет во временный файл, который после fsync атомарно заменяет исходный:
+    // сбой посреди записи не портит предыдущую версию расписания
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
         qDebug() << "Cannot open file for writing:" << filename;
         return false;
     }
 
-    QTextStream out(&file);
+    QByteArray buffer;
+    buffer.reserve(WRITE_CHUNK_SIZE);
+    {
+        QTextStream out(&buffer, QIODevice::WriteOnly);
+        setUtf8(out);
+        writeStops(out, allStops);
+        out << "SCHEDULES:" << schedules.size() << "\n";
+    }
+
+    // Неизмененные маршруты берутся из кэша готовыми байтами и пишутся крупными порциями
+    bool ok = true;
+    int encoded = 0;
+    QHash<quint64, QByteArray> written;
+    written.reserve(schedules.size());
+    for (const auto& schedule : schedules) {
+        const quint64 revision = schedule.getRevision();
+        QByteArray block;
+        {
+            QMutexLocker locker(&cacheMutex);
+            block = blockCache.value(revision);
+        }
+        if (block.isEmpty()) {
+            block = serializedSchedule(schedule);
+            ++encoded;
+        }
+        written.insert(revision, block);
+
+        buffer.append(block);
+        if (buffer.size() >= WRITE_CHUNK_SIZE) {
+            ok = ok && file.write(buffer) == buffer.size();
+            buffer.resize(0);
+        }
+    }
+    ok = ok && file.write(buffer) == buffer.size();
+
+    {
+        QMutexLocker locker(&cacheMutex);
+        blockCache = std::move(written);
+    }
+
+    if (!ok || !file.commit()) {
+        qDebug() << "Cannot commit file:" << filename << file.errorString();
+        return false;
+    }
+    qDebug() << "Successfully wrote" << schedules.size() << "schedules (" << encoded << "re-encoded) and"
+             << allStops.size() << "stops to" << filename;
+    return true;
+}
+
+QByteArray ScheduleWriter::serializedSchedule(const Schedule& schedule) const
+{
+    QByteArray block;
+    QTextStream out(&block, QIODevice::WriteOnly);
+    setUtf8(out);
+    writeSchedule(out, schedule);
+    out.flush();
+    return block;
+}
+
+void ScheduleWriter::setUtf8(QTextStream& out)
+{
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
     out.setEncoding(QStringConverter::Utf8);
 #else
     out.setCodec("UTF-8");
 #endif
+}
 
-    writeStops(out, allStops);
-    writeSchedules(out, schedules);
+bool ScheduleWriter::appendJournalPut(const QString& journalFilename, const Schedule& schedule,
+                                      const QVector<QSharedPointer<Stop>>& routeStops) const
+{
+    return appendJournal(journalFilename, [&](QTextStream& out) {
+        out << "JOURNAL_PUT\n";
+        writeStops(out, routeStops);
+        writeSchedule(out, schedule);
+    });
+}
 
-    file.close();
-    qDebug() << "Successfully wrote" << schedules.size() << "schedules and" << allStops.size() << "stops to" << filename;
-    return true;
+bool ScheduleWriter::appendJournalRemove(const QString& journalFilename, int routeNumber) const
+{
+    return appendJournal(journalFilename, [routeNumber](QTextStream& out) {
+        out << "JOURNAL_REMOVE:" << routeNumber << "\n";
+    });
+}
+
+bool ScheduleWriter::appendJournal(const QString& journalFilename,
+                                   const std::function<void(QTextStream&)>& writeRecord) const
+{
+    QFile file(journalFilename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qDebug() << "Cannot open journal for appending:" << journalFilename;
+        return false;
+    }
+
+    QTextStream out(&file);
+    setUtf8(out);
+
+    writeRecord(out);
+    out.flush();
+    return out.status() == QTextStream::Ok && file.flush();
 }
 
 void ScheduleWriter::writeStops(QTextStream& out, const QVector<QSharedPointer<Stop>>& allStops) const
@@ -38,14 +145,6 @@ void ScheduleWriter::writeStops(QTextStream& out, const QVector<QSharedPointer<S
     }
 }
 
-void ScheduleWriter::writeSchedules(QTextStream& out, const QVector<Schedule>& schedules) const
-{
-    out << "SCHEDULES:" << schedules.size() << "\n";
-    for (const auto& schedule : schedules) {
-        writeSchedule(out, schedule);
-    }
-}
-
 void ScheduleWriter::writeSchedule(QTextStream& out, const Schedule& schedule) const
 {
     const auto& route = schedule.getRoute();
@@ -54,9 +153,16 @@ void ScheduleWriter::writeSchedule(QTextStream& out, const Schedule& schedule) c
     out << "ROUTE_START\n";
     out << transport.getType().getName() << "\n";
     out << transport.getId() << "\n";
-    out << schedule.getStartTime().hours << " " << schedule.getStartTime().minutes << "\n";
+    // Все рейсы шаблона записываются в одну строку парами "H M"
+    const auto departures = schedule.getDepartures();
+    for (qsizetype i = 0; i < static_cast<qsizetype>(departures.size()); ++i) {
+        if (i > 0)
+            out << " ";
+        out << departures[i].hours << " " << departures[i].minutes;
+    }
+    out << "\n";
 
-    const auto& days = route.getDays();
+    const auto days = route.getDays().toStringList();
     out << "DAYS:" << days.size() << "\n";
     for (const auto& day : days) {
         out << day << "\n";
@@ -65,7 +171,7 @@ void ScheduleWriter::writeSchedule(QTextStream& out, const Schedule& schedule) c
     const auto& stops = route.getStops();
     out << "ROUTE_STOPS:" << stops.size() << "\n";
     for (const auto& stop : stops) {
-        out << stop.stop->getName() << "\n";
+        out << stop.getName() << "\n";
     }
 
     const auto& travelTimes = route.getTravelTimes();
@@ -74,5 +180,16 @@ void ScheduleWriter::writeSchedule(QTextStream& out, const Schedule& schedule) c
         out << time << "\n";
     }
 
+    // Частотные рейсы хранятся компактно, без разворачивания в отправления
+    const auto frequencies = schedule.getFrequencies();
+    if (!frequencies.empty()) {
+        out << "FREQUENCIES:" << frequencies.size() << "\n";
+        for (const auto& frequency : frequencies) {
+            out << frequency.getStart().hours << " " << frequency.getStart().minutes << " "
+                << frequency.getEnd().hours << " " << frequency.getEnd().minutes << " "
+                << frequency.getHeadway() << "\n";
+        }
+    }
+
     out << "ROUTE_END\n";
 }
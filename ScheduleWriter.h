@@ -5,7 +5,11 @@
 #include <QFile>
 #include <QTextStream>
 #include <QVector>
+#include <QHash>
+#include <QMutex>
+#include <QByteArray>
 #include <QSharedPointer>
+#include <functional>
 #include "Schedule.h"
 #include "Stop.h"
 
@@ -17,10 +21,30 @@ public:
     explicit ScheduleWriter(QObject *parent = nullptr);
     bool writeToFile(const QString& filename, const QVector<Schedule>& schedules, const QVector<QSharedPointer<Stop>>& allStops) const;
 
+    // Дозапись в журнал изменений: одна запись на операцию
+    bool appendJournalPut(const QString& journalFilename, const Schedule& schedule,
+                          const QVector<QSharedPointer<Stop>>& routeStops) const;
+    bool appendJournalRemove(const QString& journalFilename, int routeNumber) const;
+
 private:
+    bool appendJournal(const QString& journalFilename, const std::function<void(QTextStream&)>& writeRecord) const;
+    bool writeTextFile(const QString& filename, const QVector<Schedule>& schedules,
+                       const QVector<QSharedPointer<Stop>>& allStops) const;
     void writeStops(QTextStream& out, const QVector<QSharedPointer<Stop>>& allStops) const;
-    void writeSchedules(QTextStream& out, const QVector<Schedule>& schedules) const;
     void writeSchedule(QTextStream& out, const Schedule& schedule) const;
+
+    // Блок ROUTE_START...ROUTE_END в UTF-8; берется из кэша по ревизии расписания
+    QByteArray serializedSchedule(const Schedule& schedule) const;
+
+    static void setUtf8(QTextStream& out);
+
+    // Размер порции, которой готовые блоки отдаются в файл
+    static constexpr qsizetype WRITE_CHUNK_SIZE = 256 * 1024;
+
+    // Кэш сериализованных блоков: после каждой записи в нем остаются только
+    // ревизии, попавшие в файл. Запись может идти из фонового потока
+    mutable QMutex cacheMutex;
+    mutable QHash<quint64, QByteArray> blockCache;
 };
 
 #endif // SCHEDULEWRITER_H
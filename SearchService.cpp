@@ -1,48 +1,54 @@
 #include "SearchService.h"
 #include <algorithm>
 
-QVector<Schedule> SearchService::findSchedulesByStop(const QVector<Schedule>& schedules, const QString& stopName)
+QVector<const Schedule*> SearchService::findSchedulesByStop(const QVector<Schedule>& schedules, StopId stopId)
 {
-    QVector<Schedule> result;
+    QVector<const Schedule*> result;
 
     for (const auto& schedule : schedules) {
-        const auto& route = schedule.getRoute();
-        for (const auto& routeStop : route.getStops()) {
-            if (routeStop.stop->getName().compare(stopName, Qt::CaseInsensitive) == 0) {
-                result.push_back(schedule);
-                break;
-            }
+        if (schedule.getRoute().containsStop(stopId)) {
+            result.push_back(&schedule);
         }
     }
 
     return result;
 }
 
-QVector<Schedule> SearchService::findSchedulesByDay(const QVector<Schedule>& schedules, const QString& day)
+QVector<const Schedule*> SearchService::findSchedulesByStop(const QVector<Schedule>& schedules,
+                                                           const StopRouteIndex& index,
+                                                           StopId stopId)
 {
-    QVector<Schedule> result;
+    QVector<const Schedule*> result;
+
+    // Стоимость зависит от числа маршрутов через остановку, а не от размера сети
+    for (int scheduleIndex : index.schedulesForStop(stopId)) {
+        result.push_back(&schedules[scheduleIndex]);
+    }
+
+    return result;
+}
+
+QVector<const Schedule*> SearchService::findSchedulesByDay(const QVector<Schedule>& schedules, DayMask days)
+{
+    QVector<const Schedule*> result;
 
     for (const auto& schedule : schedules) {
-        const auto& days = schedule.getRoute().getDays();
-        for (const QString& routeDay : days) {
-            if (routeDay.compare(day, Qt::CaseInsensitive) == 0) {
-                result.push_back(schedule);
-                break;
-            }
+        if (schedule.getRoute().getDays().intersects(days)) {
+            result.push_back(&schedule);
         }
     }
 
     return result;
 }
 
-QVector<Schedule> SearchService::findSchedulesByTransportType(const QVector<Schedule>& schedules, const QString& transportType)
+QVector<const Schedule*> SearchService::findSchedulesByTransportType(const QVector<Schedule>& schedules, const QString& transportType)
 {
-    QVector<Schedule> result;
+    QVector<const Schedule*> result;
 
     for (const auto& schedule : schedules) {
         const auto& route = schedule.getRoute();
         if (route.getTransport().getType().getName().compare(transportType, Qt::CaseInsensitive) == 0) {
-            result.push_back(schedule);
+            result.push_back(&schedule);
         }
     }
 
@@ -66,27 +72,41 @@ QVector<QSharedPointer<Stop>> SearchService::findStopsByName(const QVector<QShar
     return result;
 }
 
-QVector<Schedule> SearchService::filterSchedulesByTime(const QVector<Schedule>& schedules,
+QVector<const Schedule*> SearchService::filterSchedulesByTime(const QVector<Schedule>& schedules,
                                                        const TimeTransport& fromTime,
                                                        const TimeTransport& toTime)
 {
-    QVector<Schedule> result;
+    QVector<const Schedule*> result;
+
+    // Отправления отсортированы: достаточно найти первое не раньше fromTime
+    auto hasDepartureInRange = [&fromTime, &toTime](const Schedule& schedule) {
+        const auto departures = schedule.getDepartures();
+        if (auto it = std::ranges::lower_bound(departures, fromTime);
+            it != departures.end() && *it <= toTime) {
+            return true;
+        }
+
+        // Частотные рейсы проверяются арифметически, без разворачивания
+        return std::ranges::any_of(schedule.getFrequencies(), [&](const FrequencyTrip& frequency) {
+            auto tripIndex = frequency.firstTripAtOrAfter(fromTime.toMinutes());
+            return tripIndex && frequency.getDeparture(*tripIndex) <= toTime;
+        });
+    };
 
     for (const auto& schedule : schedules) {
-        const auto& startTime = schedule.getStartTime();
-        if (startTime >= fromTime && startTime <= toTime) {
-            result.push_back(schedule);
+        if (hasDepartureInRange(schedule)) {
+            result.push_back(&schedule);
         }
     }
 
     return result;
 }
 
-QVector<Schedule> SearchService::findRoutesBetweenStops(const QVector<Schedule>& schedules,
-                                                        const QString& fromStop,
-                                                        const QString& toStop)
+QVector<const Schedule*> SearchService::findRoutesBetweenStops(const QVector<Schedule>& schedules,
+                                                        StopId fromStop,
+                                                        StopId toStop)
 {
-    QVector<Schedule> result;
+    QVector<const Schedule*> result;
 
     for (const auto& schedule : schedules) {
         const auto& route = schedule.getRoute();
@@ -96,19 +116,34 @@ QVector<Schedule> SearchService::findRoutesBetweenStops(const QVector<Schedule>&
         bool foundTo = false;
 
         for (const auto& routeStop : stops) {
-            if (routeStop.stop->getName().compare(fromStop, Qt::CaseInsensitive) == 0) {
+            if (routeStop.stopId == fromStop) {
                 foundFrom = true;
             }
-            if (foundFrom && routeStop.stop->getName().compare(toStop, Qt::CaseInsensitive) == 0) {
+            if (foundFrom && routeStop.stopId == toStop) {
                 foundTo = true;
                 break;
             }
         }
 
         if (foundFrom && foundTo) {
-            result.push_back(schedule);
+            result.push_back(&schedule);
         }
     }
 
     return result;
 }
+
+QVector<const Schedule*> SearchService::findRoutesBetweenStops(const QVector<Schedule>& schedules,
+                                                               const StopRouteIndex& index,
+                                                               StopId fromStop,
+                                                               StopId toStop)
+{
+    QVector<const Schedule*> result;
+
+    // Пересечение списков двух остановок с проверкой порядка позиций
+    for (int scheduleIndex : index.schedulesBetween(fromStop, toStop)) {
+        result.push_back(&schedules[scheduleIndex]);
+    }
+
+    return result;
+}
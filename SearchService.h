@@ -3,22 +3,32 @@
 
 #include "Schedule.h"
 #include "Stop.h"
+#include "StopRouteIndex.h"
 #include <QString>
 #include <QVector>
 
+// Результаты поиска - указатели на расписания исходного вектора,
+// действительные до его следующего изменения
 class SearchService
 {
 public:
-    static QVector<Schedule> findSchedulesByStop(const QVector<Schedule>& schedules, const QString& stopName);
-    static QVector<Schedule> findSchedulesByDay(const QVector<Schedule>& schedules, const QString& day);
-    static QVector<Schedule> findSchedulesByTransportType(const QVector<Schedule>& schedules, const QString& transportType);
+    static QVector<const Schedule*> findSchedulesByStop(const QVector<Schedule>& schedules, StopId stopId);
+    static QVector<const Schedule*> findSchedulesByStop(const QVector<Schedule>& schedules,
+                                                        const StopRouteIndex& index,
+                                                        StopId stopId);
+    static QVector<const Schedule*> findSchedulesByDay(const QVector<Schedule>& schedules, DayMask days);
+    static QVector<const Schedule*> findSchedulesByTransportType(const QVector<Schedule>& schedules, const QString& transportType);
     static QVector<QSharedPointer<Stop>> findStopsByName(const QVector<QSharedPointer<Stop>>& stops, const QString& searchTerm);
-    static QVector<Schedule> filterSchedulesByTime(const QVector<Schedule>& schedules,
+    static QVector<const Schedule*> filterSchedulesByTime(const QVector<Schedule>& schedules,
                                                    const TimeTransport& fromTime,
                                                    const TimeTransport& toTime);
-    static QVector<Schedule> findRoutesBetweenStops(const QVector<Schedule>& schedules,
-                                                    const QString& fromStop,
-                                                    const QString& toStop);
+    static QVector<const Schedule*> findRoutesBetweenStops(const QVector<Schedule>& schedules,
+                                                    StopId fromStop,
+                                                    StopId toStop);
+    static QVector<const Schedule*> findRoutesBetweenStops(const QVector<Schedule>& schedules,
+                                                           const StopRouteIndex& index,
+                                                           StopId fromStop,
+                                                           StopId toStop);
 };
 
 #endif // SEARCHSERVICE_H
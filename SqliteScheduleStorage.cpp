@@ -0,0 +1,507 @@
+#include "SqliteScheduleStorage.h"
+#include "ArrivalTimeService.h"
+#include "Transport.h"
+#include "TransportType.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QDebug>
+
+namespace {
+// Шаблон маршрута, собираемый из строк нескольких таблиц при загрузке
+struct RouteRow {
+    int routeNumber;
+    int transportType;
+    int days;
+    QVector<StopId> stops;
+    QVector<int> offsets;
+    QVector<TimeTransport> departures;
+    QVector<FrequencyTrip> frequencies;
+};
+}
+
+SqliteScheduleStorage::SqliteScheduleStorage(const QString& filename, QObject *parent)
+    : QObject(parent), filename(filename),
+    connectionName(QString("schedule-%1").arg(reinterpret_cast<quintptr>(this)))
+{
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setDatabaseName(filename);
+    if (!open()) {
+        qDebug() << "Cannot open schedule database" << filename << ":" << errorText;
+    }
+}
+
+SqliteScheduleStorage::~SqliteScheduleStorage()
+{
+    {
+        QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+bool SqliteScheduleStorage::isDatabaseFile(const QString& filename)
+{
+    return filename.endsWith(".sqlite", Qt::CaseInsensitive) || filename.endsWith(".db", Qt::CaseInsensitive);
+}
+
+QString SqliteScheduleStorage::lastError() const
+{
+    return errorText;
+}
+
+QSqlDatabase SqliteScheduleStorage::database() const
+{
+    return QSqlDatabase::database(connectionName, false);
+}
+
+bool SqliteScheduleStorage::fail(const QString& message)
+{
+    errorText = message;
+    return false;
+}
+
+bool SqliteScheduleStorage::open()
+{
+    QSqlDatabase db = database();
+    if (!db.open())
+        return fail(db.lastError().text());
+
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA foreign_keys = ON") || !query.exec("PRAGMA journal_mode = WAL"))
+        return fail(query.lastError().text());
+
+    return createSchema();
+}
+
+bool SqliteScheduleStorage::createSchema()
+{
+    // name_key - нормализованное название, как в StopRegistry: остановки сравниваются без учета регистра
+    static const char* const statements[] = {
+        "CREATE TABLE IF NOT EXISTS stops ("
+        " id INTEGER PRIMARY KEY,"
+        " name_key TEXT NOT NULL UNIQUE,"
+        " name TEXT NOT NULL,"
+        " coordinate TEXT NOT NULL DEFAULT '')",
+        "CREATE TABLE IF NOT EXISTS routes ("
+        " id INTEGER PRIMARY KEY,"
+        " pattern_key TEXT NOT NULL UNIQUE,"
+        " route_number INTEGER NOT NULL,"
+        " transport_type INTEGER NOT NULL,"
+        " days INTEGER NOT NULL)",
+        "CREATE TABLE IF NOT EXISTS route_stops ("
+        " route_id INTEGER NOT NULL REFERENCES routes(id) ON DELETE CASCADE,"
+        " position INTEGER NOT NULL,"
+        " stop_id INTEGER NOT NULL REFERENCES stops(id),"
+        " offset_minutes INTEGER NOT NULL,"
+        " PRIMARY KEY (route_id, position))",
+        "CREATE TABLE IF NOT EXISTS trips ("
+        " route_id INTEGER NOT NULL REFERENCES routes(id) ON DELETE CASCADE,"
+        " departure_minute INTEGER NOT NULL)",
+        "CREATE TABLE IF NOT EXISTS frequencies ("
+        " route_id INTEGER NOT NULL REFERENCES routes(id) ON DELETE CASCADE,"
+        " start_minute INTEGER NOT NULL,"
+        " end_minute INTEGER NOT NULL,"
+        " headway INTEGER NOT NULL)",
+        // Поиск идет по name_key с уникальным индексом; индекс по name не использовался
+        "DROP INDEX IF EXISTS stops_name",
+        "CREATE INDEX IF NOT EXISTS routes_number ON routes(route_number)",
+        "CREATE INDEX IF NOT EXISTS route_stops_stop ON route_stops(stop_id)",
+        "CREATE INDEX IF NOT EXISTS trips_route ON trips(route_id, departure_minute)",
+        "CREATE INDEX IF NOT EXISTS trips_departure ON trips(departure_minute)",
+        "CREATE INDEX IF NOT EXISTS frequencies_route ON frequencies(route_id)",
+    };
+
+    QSqlQuery query(database());
+    for (const char* statement : statements) {
+        if (!query.exec(QString::fromLatin1(statement)))
+            return fail(query.lastError().text());
+    }
+
+    // Ключи шаблонов старой базы пересчитываются при загрузке, когда известны названия остановок
+    if (!query.exec("PRAGMA user_version") || !query.next())
+        return fail(query.lastError().text());
+    patternKeysStale = query.value(0).toInt() < SCHEMA_VERSION;
+    return true;
+}
+
+bool SqliteScheduleStorage::migratePatternKeys(const QVector<qint64>& routeIds, const QVector<Schedule>& schedules)
+{
+    return runInTransaction([&]() {
+        // Сначала временные уникальные ключи: новый ключ одного шаблона
+        // не должен столкнуться со старым ключом другого
+        QSqlQuery query(database());
+        if (!query.exec("UPDATE routes SET pattern_key = '#' || id"))
+            return fail(query.lastError().text());
+
+        query.prepare("UPDATE routes SET pattern_key = ? WHERE id = ?");
+        for (int i = 0; i < routeIds.size(); ++i) {
+            query.addBindValue(patternKey(schedules[i]));
+            query.addBindValue(routeIds[i]);
+            if (!query.exec())
+                return fail(query.lastError().text());
+        }
+
+        if (!query.exec(QString("PRAGMA user_version = %1").arg(SCHEMA_VERSION)))
+            return fail(query.lastError().text());
+        patternKeysStale = false;
+        return true;
+    });
+}
+
+bool SqliteScheduleStorage::runInTransaction(const std::function<bool()>& body)
+{
+    QSqlDatabase db = database();
+    if (!db.transaction())
+        return fail(db.lastError().text());
+
+    if (!body()) {
+        db.rollback();
+        return false;
+    }
+    if (!db.commit()) {
+        const QString message = db.lastError().text();
+        db.rollback();
+        return fail(message);
+    }
+    return true;
+}
+
+ScheduleReader::ReadResult SqliteScheduleStorage::load(const StopResolver& resolveStops)
+{
+    ScheduleReader::ReadResult result;
+    result.success = false;
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+
+    // Остановки разрешаются одним пакетом, как при чтении файла
+    QStringList names;
+    QStringList coordinates;
+    QVector<qint64> stopRowIds;
+    if (!query.exec("SELECT id, name, coordinate FROM stops ORDER BY id")) {
+        result.errorMessage = query.lastError().text();
+        return result;
+    }
+    while (query.next()) {
+        stopRowIds.push_back(query.value(0).toLongLong());
+        names.push_back(query.value(1).toString());
+        coordinates.push_back(query.value(2).toString());
+    }
+    result.allStops = resolveStops(names, coordinates);
+
+    QHash<qint64, StopId> stopIds;
+    for (int i = 0; i < stopRowIds.size() && i < result.allStops.size(); ++i) {
+        stopIds.insert(stopRowIds[i], result.allStops[i]->getId());
+    }
+
+    QVector<RouteRow> rows;
+    QVector<qint64> routeIds;
+    QHash<qint64, int> rowIndex;
+
+    if (!query.exec("SELECT id, route_number, transport_type, days FROM routes ORDER BY id")) {
+        result.errorMessage = query.lastError().text();
+        return result;
+    }
+    while (query.next()) {
+        rowIndex.insert(query.value(0).toLongLong(), rows.size());
+        routeIds.push_back(query.value(0).toLongLong());
+        rows.push_back(RouteRow{query.value(1).toInt(), query.value(2).toInt(), query.value(3).toInt(), {}, {}, {}, {}});
+    }
+
+    if (!query.exec("SELECT route_id, stop_id, offset_minutes FROM route_stops ORDER BY route_id, position")) {
+        result.errorMessage = query.lastError().text();
+        return result;
+    }
+    // Строки с неизвестным route_id означают поврежденную базу - загрузка прерывается
+    auto findRow = [&](qint64 routeId) -> RouteRow* {
+        const auto it = rowIndex.constFind(routeId);
+        if (it == rowIndex.constEnd()) {
+            result.errorMessage = QString("Unknown route id %1 in database").arg(routeId);
+            return nullptr;
+        }
+        return &rows[it.value()];
+    };
+
+    while (query.next()) {
+        RouteRow* row = findRow(query.value(0).toLongLong());
+        if (!row) {
+            return result;
+        }
+        row->stops.push_back(stopIds.value(query.value(1).toLongLong(), StopRegistry::INVALID_ID));
+        row->offsets.push_back(query.value(2).toInt());
+    }
+
+    if (!query.exec("SELECT route_id, departure_minute FROM trips")) {
+        result.errorMessage = query.lastError().text();
+        return result;
+    }
+    while (query.next()) {
+        RouteRow* row = findRow(query.value(0).toLongLong());
+        if (!row) {
+            return result;
+        }
+        row->departures.push_back(TimeTransport(0, query.value(1).toInt()));
+    }
+
+    if (!query.exec("SELECT route_id, start_minute, end_minute, headway FROM frequencies")) {
+        result.errorMessage = query.lastError().text();
+        return result;
+    }
+    while (query.next()) {
+        RouteRow* row = findRow(query.value(0).toLongLong());
+        if (!row) {
+            return result;
+        }
+        row->frequencies.push_back(
+            FrequencyTrip(TimeTransport(0, query.value(1).toInt()), TimeTransport(0, query.value(2).toInt()),
+                          query.value(3).toInt()));
+    }
+
+    result.schedules.reserve(rows.size());
+    for (const auto& row : rows) {
+        if (row.stops.size() < 2 || row.stops.contains(StopRegistry::INVALID_ID)) {
+            result.errorMessage = QString("Invalid route data for route %1").arg(row.routeNumber);
+            return result;
+        }
+
+        Transport transport(TransportType(static_cast<TransportType::Type>(row.transportType)), row.routeNumber);
+        Route route(transport, row.stops.first(), row.stops.last());
+        route.setDays(DayMask(static_cast<std::uint8_t>(row.days)));
+        for (int i = 1; i + 1 < row.stops.size(); ++i) {
+            route.addStop(row.stops[i], row.offsets[i] - row.offsets[i - 1]);
+        }
+        route.addFinalTravelTime(row.offsets.last() - row.offsets[row.offsets.size() - 2]);
+
+        Schedule schedule(route, row.departures);
+        schedule.setFrequencies(row.frequencies);
+        result.schedules.push_back(schedule);
+    }
+
+    if (patternKeysStale && !migratePatternKeys(routeIds, result.schedules)) {
+        result.errorMessage = errorText;
+        return result;
+    }
+
+    qDebug() << "Loaded" << result.schedules.size() << "schedules from database" << filename;
+    result.success = true;
+    return result;
+}
+
+bool SqliteScheduleStorage::saveAll(const QVector<Schedule>& schedules, const QVector<QSharedPointer<Stop>>& allStops)
+{
+    return runInTransaction([&]() {
+        QSqlQuery query(database());
+        for (const char* table : {"frequencies", "trips", "route_stops", "routes", "stops"}) {
+            if (!query.exec(QString("DELETE FROM %1").arg(table)))
+                return fail(query.lastError().text());
+        }
+
+        QHash<StopId, qint64> stopRows;
+        stopRows.reserve(allStops.size());
+        for (const auto& stop : allStops) {
+            qint64 rowId = 0;
+            if (!upsertStop(*stop, rowId))
+                return false;
+            stopRows.insert(stop->getId(), rowId);
+        }
+
+        for (const auto& schedule : schedules) {
+            if (!insertSchedule(schedule, stopRows))
+                return false;
+        }
+        return true;
+    });
+}
+
+bool SqliteScheduleStorage::putSchedule(const Schedule& schedule, const QVector<QSharedPointer<Stop>>& routeStops)
+{
+    return runInTransaction([&]() {
+        QHash<StopId, qint64> stopRows;
+        for (const auto& stop : routeStops) {
+            qint64 rowId = 0;
+            if (!upsertStop(*stop, rowId))
+                return false;
+            stopRows.insert(stop->getId(), rowId);
+        }
+
+        // Строки остановок, рейсов и интервалов удаляются каскадно вместе с шаблоном
+        QSqlQuery query(database());
+        query.prepare("DELETE FROM routes WHERE pattern_key = ?");
+        query.addBindValue(patternKey(schedule));
+        if (!query.exec())
+            return fail(query.lastError().text());
+
+        return insertSchedule(schedule, stopRows);
+    });
+}
+
+bool SqliteScheduleStorage::removeRoute(int routeNumber)
+{
+    return runInTransaction([&]() {
+        QSqlQuery query(database());
+        query.prepare("DELETE FROM routes WHERE route_number = ?");
+        query.addBindValue(routeNumber);
+        return query.exec() || fail(query.lastError().text());
+    });
+}
+
+QVector<SqliteScheduleStorage::NextDeparture> SqliteScheduleStorage::findNextDepartures(
+    const QString& stopName, DayMask days, int minuteOfDay, int limit)
+{
+    // Семантика совпадает с DepartureIndex::nextArrivals: время прибытия берется по модулю суток,
+    // ожидание считается по кругу суток (после последнего рейса - первый рейс следующего дня).
+    // target - минута отправления с начальной остановки, при которой рейс прибывает сейчас;
+    // явные рейсы выбираются двумя диапазонами departure_minute >= target и < target,
+    // которые обслуживает индекс trips_route(route_id, departure_minute).
+    // Для частотных интервалов рейсы нумеруются арифметически, не более limit на интервал
+    QSqlQuery query(database());
+    query.prepare(
+        "WITH RECURSIVE params(stop_key, days, now_minute, max_rows) AS (SELECT ?, ?, ?, ?), "
+        "seq(k) AS (SELECT 0 UNION ALL SELECT seq.k + 1 FROM seq, params WHERE seq.k + 1 < params.max_rows), "
+        "stop_routes AS ("
+        " SELECT r.id AS route_id, r.route_number, r.transport_type, rs.position, rs.offset_minutes,"
+        "  ((p.now_minute - rs.offset_minutes) % 1440 + 1440) % 1440 AS target"
+        " FROM params p"
+        " JOIN stops s ON s.name_key = p.stop_key"
+        " JOIN route_stops rs ON rs.stop_id = s.id"
+        " JOIN routes r ON r.id = rs.route_id"
+        " WHERE (r.days & p.days) != 0), "
+        "frequency_base AS ("
+        " SELECT sr.route_number, sr.transport_type, sr.position, sr.offset_minutes, sr.target,"
+        "  f.start_minute, f.headway, (f.end_minute - f.start_minute) / f.headway + 1 AS trip_count,"
+        "  CASE WHEN sr.target <= f.start_minute"
+        "        OR sr.target > f.start_minute + f.headway * ((f.end_minute - f.start_minute) / f.headway) THEN 0"
+        "       ELSE (sr.target - f.start_minute + f.headway - 1) / f.headway END AS first_trip"
+        " FROM stop_routes sr"
+        " JOIN frequencies f ON f.route_id = sr.route_id"
+        " WHERE f.headway > 0 AND f.end_minute >= f.start_minute), "
+        "candidates AS ("
+        " SELECT sr.route_number, sr.transport_type, sr.position,"
+        "  t.departure_minute + sr.offset_minutes AS arrival, t.departure_minute - sr.target AS wait"
+        " FROM stop_routes sr"
+        " JOIN trips t ON t.route_id = sr.route_id AND t.departure_minute >= sr.target"
+        " UNION ALL"
+        " SELECT sr.route_number, sr.transport_type, sr.position,"
+        "  t.departure_minute + sr.offset_minutes, t.departure_minute - sr.target + 1440"
+        " FROM stop_routes sr"
+        " JOIN trips t ON t.route_id = sr.route_id AND t.departure_minute < sr.target"
+        " UNION ALL"
+        " SELECT route_number, transport_type, position, departure + offset_minutes,"
+        "  ((departure - target) % 1440 + 1440) % 1440"
+        " FROM (SELECT fb.*, fb.start_minute + fb.headway * ((fb.first_trip + seq.k) % fb.trip_count) AS departure"
+        "       FROM frequency_base fb JOIN seq ON seq.k < fb.trip_count)) "
+        "SELECT route_number, transport_type, position, arrival % 1440"
+        " FROM candidates ORDER BY wait LIMIT ?");
+    query.addBindValue(StopRegistry::normalize(stopName));
+    query.addBindValue(static_cast<int>(days.toBits()));
+    query.addBindValue(minuteOfDay);
+    query.addBindValue(limit);
+    query.addBindValue(limit);
+
+    QVector<NextDeparture> departures;
+    if (!query.exec()) {
+        fail(query.lastError().text());
+        return departures;
+    }
+    while (query.next()) {
+        departures.push_back(NextDeparture{query.value(0).toInt(), query.value(1).toInt(),
+                                           query.value(2).toInt(), query.value(3).toInt()});
+    }
+    return departures;
+}
+
+bool SqliteScheduleStorage::upsertStop(const Stop& stop, qint64& rowId)
+{
+    const QString key = StopRegistry::normalize(stop.getName());
+
+    QSqlQuery query(database());
+    query.prepare("INSERT INTO stops(name_key, name, coordinate) VALUES (?, ?, ?) "
+                  "ON CONFLICT(name_key) DO UPDATE SET coordinate = excluded.coordinate "
+                  "WHERE excluded.coordinate != ''");
+    query.addBindValue(key);
+    query.addBindValue(stop.getName());
+    query.addBindValue(stop.getCoordinate());
+    if (!query.exec())
+        return fail(query.lastError().text());
+
+    query.prepare("SELECT id FROM stops WHERE name_key = ?");
+    query.addBindValue(key);
+    if (!query.exec() || !query.next())
+        return fail(query.lastError().text());
+
+    rowId = query.value(0).toLongLong();
+    return true;
+}
+
+bool SqliteScheduleStorage::insertSchedule(const Schedule& schedule, const QHash<StopId, qint64>& stopRows)
+{
+    const Route& route = schedule.getRoute();
+    QSqlQuery query(database());
+
+    query.prepare("INSERT INTO routes(pattern_key, route_number, transport_type, days) VALUES (?, ?, ?, ?)");
+    query.addBindValue(patternKey(schedule));
+    query.addBindValue(route.getRouteNumber());
+    query.addBindValue(route.getTransport().getType().getId());
+    query.addBindValue(static_cast<int>(route.getDays().toBits()));
+    if (!query.exec())
+        return fail(query.lastError().text());
+    const qint64 routeId = query.lastInsertId().toLongLong();
+
+    const auto stops = route.getStops();
+    const auto offsets = route.getOffsets();
+    query.prepare("INSERT INTO route_stops(route_id, position, stop_id, offset_minutes) VALUES (?, ?, ?, ?)");
+    for (std::size_t i = 0; i < stops.size(); ++i) {
+        const auto stopRow = stopRows.constFind(stops[i].stopId);
+        if (stopRow == stopRows.constEnd())
+            return fail(QString("Stop of route %1 is not stored").arg(route.getRouteNumber()));
+
+        query.addBindValue(routeId);
+        query.addBindValue(static_cast<int>(i));
+        query.addBindValue(*stopRow);
+        query.addBindValue(offsets[i]);
+        if (!query.exec())
+            return fail(query.lastError().text());
+    }
+
+    query.prepare("INSERT INTO trips(route_id, departure_minute) VALUES (?, ?)");
+    for (const auto& departure : schedule.getDepartures()) {
+        query.addBindValue(routeId);
+        query.addBindValue(departure.toMinutes());
+        if (!query.exec())
+            return fail(query.lastError().text());
+    }
+
+    query.prepare("INSERT INTO frequencies(route_id, start_minute, end_minute, headway) VALUES (?, ?, ?, ?)");
+    for (const auto& frequency : schedule.getFrequencies()) {
+        query.addBindValue(routeId);
+        query.addBindValue(frequency.getStart().toMinutes());
+        query.addBindValue(frequency.getEnd().toMinutes());
+        query.addBindValue(frequency.getHeadway());
+        if (!query.exec())
+            return fail(query.lastError().text());
+    }
+    return true;
+}
+
+QString SqliteScheduleStorage::patternKey(const Schedule& schedule)
+{
+    // Те же поля, что сравнивает Route::hasSamePattern
+    const Route& route = schedule.getRoute();
+    QStringList parts;
+    parts << QString::number(route.getTransport().getType().getId())
+          << QString::number(route.getRouteNumber())
+          << QString::number(route.getDays().toBits());
+
+    // Названия могут содержать '/' и '|', поэтому каждое предваряется своей длиной
+    QStringList stopKeys;
+    for (const auto& stop : route.getStops()) {
+        const QString name = StopRegistry::normalize(StopRegistry::instance().name(stop.stopId));
+        stopKeys << QString::number(name.size()) + ':' + name;
+    }
+    QStringList travelTimes;
+    for (int time : route.getTravelTimes()) {
+        travelTimes << QString::number(time);
+    }
+    parts << stopKeys.join('/') << travelTimes.join(',');
+    return parts.join('|');
+}
@@ -0,0 +1,74 @@
+#ifndef SQLITESCHEDULESTORAGE_H
+#define SQLITESCHEDULESTORAGE_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+#include <functional>
+#include "ScheduleReader.h"
+#include "Schedule.h"
+#include "Stop.h"
+#include "DayMask.h"
+
+// Хранение расписания в базе SQLite (драйвер QSQLITE). Нормализованные таблицы:
+// stops, routes (шаблон маршрута), route_stops (остановки шаблона со смещениями),
+// trips (явные отправления) и frequencies (частотные интервалы).
+// Каждое изменение записывается отдельной транзакцией, поэтому журнал не нужен.
+class SqliteScheduleStorage : public QObject
+{
+    Q_OBJECT
+
+public:
+    using StopResolver = std::function<QVector<QSharedPointer<Stop>>(const QStringList&, const QStringList&)>;
+
+    // Ближайшее прибытие, вычисленное запросом на стороне базы
+    struct NextDeparture {
+        int routeNumber;
+        int transportType;
+        int stopPosition;
+        int arrivalMinute;
+    };
+
+    explicit SqliteScheduleStorage(const QString& filename, QObject *parent = nullptr);
+    ~SqliteScheduleStorage() override;
+
+    // Файлы .sqlite и .db хранятся в базе, остальные - в текстовом или бинарном формате
+    static bool isDatabaseFile(const QString& filename);
+
+    ScheduleReader::ReadResult load(const StopResolver& resolveStops);
+    bool saveAll(const QVector<Schedule>& schedules, const QVector<QSharedPointer<Stop>>& allStops);
+
+    // Замена шаблона маршрута (или добавление нового) и удаление маршрута по номеру
+    bool putSchedule(const Schedule& schedule, const QVector<QSharedPointer<Stop>>& routeStops);
+    bool removeRoute(int routeNumber);
+
+    QVector<NextDeparture> findNextDepartures(const QString& stopName, DayMask days, int minuteOfDay, int limit);
+
+    QString lastError() const;
+
+private:
+    bool open();
+    bool createSchema();
+    // Пересчет pattern_key в текущем формате для базы, созданной прежней версией
+    bool migratePatternKeys(const QVector<qint64>& routeIds, const QVector<Schedule>& schedules);
+    bool runInTransaction(const std::function<bool()>& body);
+    bool upsertStop(const Stop& stop, qint64& rowId);
+    bool insertSchedule(const Schedule& schedule, const QHash<StopId, qint64>& stopRows);
+    bool fail(const QString& message);
+
+    static QString patternKey(const Schedule& schedule);
+
+    // PRAGMA user_version; 2 - названия остановок в pattern_key с префиксом длины
+    static constexpr int SCHEMA_VERSION = 2;
+
+    QSqlDatabase database() const;
+
+    QString filename;
+    QString connectionName;
+    QString errorText;
+    bool patternKeysStale = false;
+};
+
+#endif // SQLITESCHEDULESTORAGE_H
@@ -3,14 +3,18 @@
 
 #include "Schedule.h"
 #include "Stop.h"
+#include "StopUsageIndex.h"
+#include "ScheduleStatistics.h"
 #include <QVector>
 #include <QMap>
+#include <functional>
 
 class StatisticsService
 {
 public:
     struct RouteStats {
         int totalRoutes;
+        int totalTrips;
         int busCount;
         int trolleybusCount;
         int tramCount;
@@ -24,15 +28,15 @@ public:
         int totalStops;
         int activeStops;
         QVector<QSharedPointer<Stop>> mostPopularStops;
-        QMap<QString, int> stopUsageCount;
+        QMap<int, int> usageHistogram; // число вхождений -> количество остановок
     };
 
-    static RouteStats calculateRouteStatistics(const QVector<Schedule>& schedules);
-    static StopStats calculateStopStatistics(const QVector<Schedule>& schedules,
-                                             const QVector<QSharedPointer<Stop>>& allStops);
-    static QMap<QString, int> calculateDailyScheduleCount(const QVector<Schedule>& schedules);
-    static double calculateAverageStopsPerRoute(const QVector<Schedule>& schedules);
-    static QMap<QString, int> calculateTransportTypeDistribution(const QVector<Schedule>& schedules);
+    // По накопленным счетчикам TransportSchedule, без обхода маршрутов
+    static RouteStats calculateRouteStatistics(const ScheduleStatistics& statistics);
+    static StopStats calculateStopStatistics(const StopUsageIndex& usage, int totalStops,
+                                             const std::function<QSharedPointer<Stop>(StopId)>& findStop);
+    static QMap<QString, int> calculateDailyScheduleCount(const ScheduleStatistics& statistics);
+    static QMap<QString, int> calculateTransportTypeDistribution(const ScheduleStatistics& statistics);
 };
 
 #endif // STATISTICSSERVICE_H
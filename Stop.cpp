@@ -1,7 +1,11 @@
 #include "Stop.h"
 
 Stop::Stop(const QString& name, const QString& coordinate)
-    : name(name), coordinate(coordinate) {}
+    : id(StopRegistry::instance().intern(name)), name(name), coordinate(coordinate) {}
+
+StopId Stop::getId() const {
+    return id;
+}
 
 QString Stop::getName() const {
     return name;
@@ -13,6 +17,7 @@ QString Stop::getCoordinate() const {
 
 void Stop::setName(const QString& newName) {
     name = newName;
+    id = StopRegistry::instance().intern(newName);
 }
 
 void Stop::setCoordinate(const QString& newCoordinate) {
@@ -2,11 +2,13 @@
 #define STOP_H
 
 #include <QString>
+#include "StopRegistry.h"
 
 class Stop {
 public:
     explicit Stop(const QString& name = "", const QString& coordinate = "");
 
+    StopId getId() const;
     QString getName() const;
     QString getCoordinate() const;
     void setName(const QString& newName);
@@ -15,6 +17,7 @@ public:
     bool operator==(const Stop& other) const = default;
 
 private:
+    StopId id;
     QString name;
     QString coordinate;
 };
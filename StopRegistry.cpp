@@ -0,0 +1,57 @@
+#include "StopRegistry.h"
+#include <QReadLocker>
+#include <QWriteLocker>
+
+StopRegistry& StopRegistry::instance()
+{
+    static StopRegistry registry;
+    return registry;
+}
+
+StopId StopRegistry::intern(const QString& name)
+{
+    QString key = normalize(name);
+    {
+        QReadLocker locker(&lock);
+        if (auto it = ids.constFind(key); it != ids.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QWriteLocker locker(&lock);
+    if (auto it = ids.constFind(key); it != ids.constEnd()) {
+        return it.value();
+    }
+
+    auto id = static_cast<StopId>(names.size());
+    ids.insert(key, id);
+    names.push_back(name);
+    return id;
+}
+
+StopId StopRegistry::find(const QString& name) const
+{
+    const QString key = normalize(name);
+    QReadLocker locker(&lock);
+    return ids.value(key, INVALID_ID);
+}
+
+QString StopRegistry::name(StopId id) const
+{
+    QReadLocker locker(&lock);
+    if (id >= static_cast<StopId>(names.size())) {
+        return QString();
+    }
+    return names[id];
+}
+
+int StopRegistry::size() const
+{
+    QReadLocker locker(&lock);
+    return names.size();
+}
+
+QString StopRegistry::normalize(const QString& name)
+{
+    return name.toCaseFolded();
+}
@@ -0,0 +1,39 @@
+#ifndef STOPREGISTRY_H
+#define STOPREGISTRY_H
+
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <QReadWriteLock>
+#include <cstdint>
+
+// Плотный числовой идентификатор остановки
+using StopId = std::uint32_t;
+
+// Таблица интернирования названий остановок: каждому нормализованному
+// названию (без учета регистра) сопоставляется плотный StopId.
+// Горячие пути сравнивают идентификаторы, названия нужны только для отображения.
+// Реестр потокобезопасен: названия читаются и фоновой записью расписания.
+class StopRegistry
+{
+public:
+    static constexpr StopId INVALID_ID = UINT32_MAX;
+
+    static StopRegistry& instance();
+
+    StopId intern(const QString& name);
+    StopId find(const QString& name) const;
+    QString name(StopId id) const;
+    int size() const;
+
+    static QString normalize(const QString& name);
+
+private:
+    StopRegistry() = default;
+
+    mutable QReadWriteLock lock;
+    QHash<QString, StopId> ids;
+    QVector<QString> names;
+};
+
+#endif // STOPREGISTRY_H
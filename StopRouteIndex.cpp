@@ -0,0 +1,141 @@
+#include "StopRouteIndex.h"
+#include <algorithm>
+
+namespace {
+bool postingLess(const StopRouteIndex::Posting& a, const StopRouteIndex::Posting& b)
+{
+    return a.scheduleIndex != b.scheduleIndex ? a.scheduleIndex < b.scheduleIndex
+                                              : a.position < b.position;
+}
+}
+
+void StopRouteIndex::build(const QVector<Schedule>& schedules)
+{
+    clear();
+    postingsByStop.resize(StopRegistry::instance().size());
+
+    // Расписания добавляются по возрастанию индекса - списки остаются отсортированными
+    for (int i = 0; i < schedules.size(); ++i) {
+        addSchedule(i, schedules[i]);
+    }
+}
+
+void StopRouteIndex::clear()
+{
+    postingsByStop.clear();
+}
+
+void StopRouteIndex::addSchedule(int scheduleIndex, const Schedule& schedule)
+{
+    const auto stops = schedule.getRoute().getStops();
+    for (int position = 0; position < static_cast<int>(stops.size()); ++position) {
+        const StopId stopId = stops[position].stopId;
+        if (stopId >= static_cast<StopId>(postingsByStop.size())) {
+            postingsByStop.resize(std::max(StopRegistry::instance().size(), static_cast<int>(stopId) + 1));
+        }
+
+        auto& postings = postingsByStop[stopId];
+        const Posting posting{scheduleIndex, position};
+        postings.insert(std::upper_bound(postings.begin(), postings.end(), posting, postingLess), posting);
+    }
+}
+
+void StopRouteIndex::removeSchedule(int scheduleIndex, const Schedule& schedule)
+{
+    for (const auto& routeStop : schedule.getRoute().getStops()) {
+        if (routeStop.stopId >= static_cast<StopId>(postingsByStop.size())) {
+            continue;
+        }
+
+        // Записи расписания идут подряд: список отсортирован по индексу расписания
+        auto& postings = postingsByStop[routeStop.stopId];
+        const auto [first, last] = std::equal_range(postings.begin(), postings.end(), Posting{scheduleIndex, 0},
+                                                    [](const Posting& a, const Posting& b) {
+                                                        return a.scheduleIndex < b.scheduleIndex;
+                                                    });
+        postings.erase(first, last);
+    }
+}
+
+void StopRouteIndex::moveSchedule(int fromIndex, int toIndex, const Schedule& schedule)
+{
+    for (const auto& routeStop : schedule.getRoute().getStops()) {
+        if (routeStop.stopId >= static_cast<StopId>(postingsByStop.size())) {
+            continue;
+        }
+
+        // Записи переносятся на позицию нового индекса, чтобы список остался отсортированным
+        auto& postings = postingsByStop[routeStop.stopId];
+        QVector<Posting> moved;
+        auto [first, last] = std::ranges::remove_if(postings, [&moved, fromIndex, toIndex](const Posting& p) {
+            if (p.scheduleIndex != fromIndex) return false;
+            moved.push_back(Posting{toIndex, p.position});
+            return true;
+        });
+        postings.erase(first, last);
+        for (const auto& posting : moved) {
+            postings.insert(std::upper_bound(postings.begin(), postings.end(), posting, postingLess), posting);
+        }
+    }
+}
+
+void StopRouteIndex::assignStop(StopId stopId, std::span<const Posting> postings)
+{
+    if (stopId >= static_cast<StopId>(postingsByStop.size())) {
+        postingsByStop.resize(std::max(StopRegistry::instance().size(), static_cast<int>(stopId) + 1));
+    }
+    postingsByStop[stopId] = QVector<Posting>(postings.begin(), postings.end());
+}
+
+std::span<const StopRouteIndex::Posting> StopRouteIndex::postingsForStop(StopId stopId) const
+{
+    if (stopId >= static_cast<StopId>(postingsByStop.size())) {
+        return {};
+    }
+    const auto& postings = postingsByStop[stopId];
+    return {postings.constData(), static_cast<std::size_t>(postings.size())};
+}
+
+QVector<int> StopRouteIndex::schedulesForStop(StopId stopId) const
+{
+    QVector<int> result;
+    for (const auto& posting : postingsForStop(stopId)) {
+        // Маршрут может проходить через остановку несколько раз
+        if (result.isEmpty() || result.last() != posting.scheduleIndex) {
+            result.push_back(posting.scheduleIndex);
+        }
+    }
+    return result;
+}
+
+QVector<int> StopRouteIndex::schedulesBetween(StopId fromStop, StopId toStop) const
+{
+    QVector<int> result;
+    const auto from = postingsForStop(fromStop);
+    const auto to = postingsForStop(toStop);
+
+    // Пересечение двух отсортированных списков: для общего расписания достаточно,
+    // чтобы первая позиция fromStop была не больше последней позиции toStop
+    // (при fromStop == toStop подходит любой маршрут через остановку, как при полном обходе)
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < from.size() && j < to.size()) {
+        if (from[i].scheduleIndex < to[j].scheduleIndex) {
+            ++i;
+        } else if (to[j].scheduleIndex < from[i].scheduleIndex) {
+            ++j;
+        } else {
+            const int scheduleIndex = from[i].scheduleIndex;
+            const int firstFrom = from[i].position;
+            int lastTo = to[j].position;
+            while (i < from.size() && from[i].scheduleIndex == scheduleIndex) ++i;
+            while (j < to.size() && to[j].scheduleIndex == scheduleIndex) lastTo = to[j++].position;
+
+            if (firstFrom <= lastTo) {
+                result.push_back(scheduleIndex);
+            }
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,44 @@
+#ifndef STOPROUTEINDEX_H
+#define STOPROUTEINDEX_H
+
+#include <QVector>
+#include <span>
+#include "Schedule.h"
+#include "StopRegistry.h"
+
+// Инвертированный индекс "остановка -> маршруты": для каждого StopId хранится
+// список (индекс расписания, позиция остановки в маршруте), отсортированный
+// по индексу расписания и позиции. Расписания адресуются индексом в векторе
+// TransportSchedule::schedules.
+class StopRouteIndex
+{
+public:
+    struct Posting {
+        int scheduleIndex;
+        int position;
+    };
+
+    void build(const QVector<Schedule>& schedules);
+    void clear();
+
+    // Изменения затрагивают только остановки маршрута расписания
+    void addSchedule(int scheduleIndex, const Schedule& schedule);
+    void removeSchedule(int scheduleIndex, const Schedule& schedule);
+    // Перенумерация расписания (например, при переносе последнего на место удаленного)
+    void moveSchedule(int fromIndex, int toIndex, const Schedule& schedule);
+
+    std::span<const Posting> postingsForStop(StopId stopId) const;
+
+    // Загрузка готового (уже отсортированного) списка остановки, например из файла индекса
+    void assignStop(StopId stopId, std::span<const Posting> postings);
+
+    // Индексы расписаний, проходящих через остановку (по возрастанию)
+    QVector<int> schedulesForStop(StopId stopId) const;
+    // Индексы расписаний, в которых fromStop встречается раньше toStop
+    QVector<int> schedulesBetween(StopId fromStop, StopId toStop) const;
+
+private:
+    QVector<QVector<Posting>> postingsByStop;
+};
+
+#endif // STOPROUTEINDEX_H
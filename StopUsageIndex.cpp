@@ -0,0 +1,123 @@
+#include "StopUsageIndex.h"
+#include <algorithm>
+
+void StopUsageIndex::build(const QVector<Schedule>& schedules)
+{
+    clear();
+    usageByStop.fill(0, StopRegistry::instance().size());
+    activePositions.fill(-1, StopRegistry::instance().size());
+
+    for (const auto& schedule : schedules) {
+        addSchedule(schedule);
+    }
+}
+
+void StopUsageIndex::clear()
+{
+    usageByStop.clear();
+    stopsByUsage.clear();
+    activeStopIds.clear();
+    activePositions.clear();
+}
+
+bool StopUsageIndex::addSchedule(const Schedule& schedule)
+{
+    bool activeChanged = false;
+    for (const auto& routeStop : schedule.getRoute().getStops()) {
+        const StopId stopId = routeStop.stopId;
+        if (stopId >= static_cast<StopId>(usageByStop.size())) {
+            const int oldSize = usageByStop.size();
+            const int size = std::max(StopRegistry::instance().size(), static_cast<int>(stopId) + 1);
+            usageByStop.resize(size);
+            activePositions.resize(size);
+            std::fill(activePositions.begin() + oldSize, activePositions.end(), -1);
+        }
+
+        const int previous = usageByStop[stopId]++;
+        moveToBucket(stopId, previous, previous + 1);
+        if (previous == 0) {
+            activePositions[stopId] = activeStopIds.size();
+            activeStopIds.push_back(stopId);
+            activeChanged = true;
+        }
+    }
+    return activeChanged;
+}
+
+bool StopUsageIndex::removeSchedule(const Schedule& schedule)
+{
+    bool activeChanged = false;
+    for (const auto& routeStop : schedule.getRoute().getStops()) {
+        const StopId stopId = routeStop.stopId;
+        if (stopId >= static_cast<StopId>(usageByStop.size()) || usageByStop[stopId] == 0) {
+            continue;
+        }
+
+        const int previous = usageByStop[stopId]--;
+        moveToBucket(stopId, previous, previous - 1);
+        if (previous == 1) {
+            // Последний элемент переносится на место удаленного
+            const int position = activePositions[stopId];
+            const StopId moved = activeStopIds.last();
+            activeStopIds[position] = moved;
+            activePositions[moved] = position;
+            activeStopIds.removeLast();
+            activePositions[stopId] = -1;
+            activeChanged = true;
+        }
+    }
+    return activeChanged;
+}
+
+int StopUsageIndex::usage(StopId stopId) const
+{
+    return stopId < static_cast<StopId>(usageByStop.size()) ? usageByStop[stopId] : 0;
+}
+
+QVector<StopId> StopUsageIndex::mostUsed(int count) const
+{
+    QVector<StopId> result;
+    for (auto it = stopsByUsage.constEnd(); it != stopsByUsage.constBegin() && result.size() < count;) {
+        --it;
+        for (StopId stopId : it.value()) {
+            if (result.size() == count) {
+                break;
+            }
+            result.push_back(stopId);
+        }
+    }
+    return result;
+}
+
+QMap<int, int> StopUsageIndex::usageHistogram() const
+{
+    QMap<int, int> histogram;
+    for (auto it = stopsByUsage.constBegin(); it != stopsByUsage.constEnd(); ++it) {
+        histogram.insert(it.key(), it.value().size());
+    }
+    return histogram;
+}
+
+void StopUsageIndex::moveToBucket(StopId stopId, int from, int to)
+{
+    if (from > 0) {
+        auto bucket = stopsByUsage.find(from);
+        bucket.value().remove(stopId);
+        if (bucket.value().isEmpty()) {
+            stopsByUsage.erase(bucket);
+        }
+    }
+    if (to > 0) {
+        stopsByUsage[to].insert(stopId);
+    }
+}
+
+bool StopUsageIndex::isActive(StopId stopId) const
+{
+    return usage(stopId) > 0;
+}
+
+const QVector<StopId>& StopUsageIndex::activeStops() const
+{
+    return activeStopIds;
+}
@@ -0,0 +1,44 @@
+#ifndef STOPUSAGEINDEX_H
+#define STOPUSAGEINDEX_H
+
+#include <QVector>
+#include <QMap>
+#include <QSet>
+#include "Schedule.h"
+#include "StopRegistry.h"
+
+// Счетчики использования остановок: для каждого StopId хранится число
+// вхождений остановки в маршруты всех расписаний. Счетчики обновляются
+// при добавлении и удалении расписаний, поэтому список активных остановок
+// (с ненулевым счетчиком) доступен без обхода маршрутов.
+class StopUsageIndex
+{
+public:
+    void build(const QVector<Schedule>& schedules);
+    void clear();
+
+    // Возвращают true, если изменился набор активных остановок
+    bool addSchedule(const Schedule& schedule);
+    bool removeSchedule(const Schedule& schedule);
+
+    int usage(StopId stopId) const;
+    bool isActive(StopId stopId) const;
+    // Активные остановки в порядке появления (после удалений порядок не сохраняется)
+    const QVector<StopId>& activeStops() const;
+    // Не более count остановок с наибольшим числом вхождений, по убыванию
+    QVector<StopId> mostUsed(int count) const;
+    // Число вхождений -> количество остановок с таким числом
+    QMap<int, int> usageHistogram() const;
+
+private:
+    void moveToBucket(StopId stopId, int from, int to);
+
+    QVector<int> usageByStop;
+    // Остановки, сгруппированные по числу вхождений (без нулевого): при изменении
+    // счетчика на единицу остановка переходит в соседнюю группу
+    QMap<int, QSet<StopId>> stopsByUsage;
+    QVector<StopId> activeStopIds;
+    QVector<int> activePositions; // StopId -> индекс в activeStopIds (-1, если не активна)
+};
+
+#endif // STOPUSAGEINDEX_H
@@ -0,0 +1,80 @@
+#include "TimetableSnapshot.h"
+#include "SearchService.h"
+
+TimetableSnapshot::TimetableSnapshot(quint64 version,
+                                     QVector<Schedule> schedules,
+                                     QVector<QSharedPointer<Stop>> stops,
+                                     QVector<int> stopPositions,
+                                     QVector<QSharedPointer<Stop>> activeStops,
+                                     DepartureIndex departureIndex,
+                                     StopRouteIndex stopRouteIndex)
+    : snapshotVersion(version), scheduleList(std::move(schedules)), stopList(std::move(stops)),
+    stopPositions(std::move(stopPositions)), activeStopList(std::move(activeStops)),
+    departureIndex(std::move(departureIndex)), stopRouteIndex(std::move(stopRouteIndex))
+{
+}
+
+quint64 TimetableSnapshot::version() const
+{
+    return snapshotVersion;
+}
+
+const QVector<Schedule>& TimetableSnapshot::schedules() const
+{
+    return scheduleList;
+}
+
+const QVector<QSharedPointer<Stop>>& TimetableSnapshot::stops() const
+{
+    return stopList;
+}
+
+const QVector<QSharedPointer<Stop>>& TimetableSnapshot::activeStops() const
+{
+    return activeStopList;
+}
+
+const DepartureIndex& TimetableSnapshot::departures() const
+{
+    return departureIndex;
+}
+
+const StopRouteIndex& TimetableSnapshot::stopRoutes() const
+{
+    return stopRouteIndex;
+}
+
+QSharedPointer<Stop> TimetableSnapshot::findStop(StopId stopId) const
+{
+    if (stopId >= static_cast<StopId>(stopPositions.size())) {
+        return {};
+    }
+    const int position = stopPositions[stopId];
+    return position >= 0 ? stopList[position] : QSharedPointer<Stop>();
+}
+
+QVector<const Schedule*> TimetableSnapshot::schedulesForDay(DayMask days) const
+{
+    return SearchService::findSchedulesByDay(scheduleList, days);
+}
+
+QVector<const Schedule*> TimetableSnapshot::schedulesForStop(StopId stopId) const
+{
+    return SearchService::findSchedulesByStop(scheduleList, stopRouteIndex, stopId);
+}
+
+QVector<const Schedule*> TimetableSnapshot::routesBetweenStops(StopId fromStop, StopId toStop) const
+{
+    return SearchService::findRoutesBetweenStops(scheduleList, stopRouteIndex, fromStop, toStop);
+}
+
+QVector<TripArrival> TimetableSnapshot::nextTransport(StopId stopId, const TimeTransport& currentTime, DayMask days) const
+{
+    return departureIndex.nextArrivalPerSchedule(stopId, currentTime, days, scheduleList);
+}
+
+QVector<TripArrival> TimetableSnapshot::nextDepartures(StopId stopId, const TimeTransport& currentTime, DayMask days,
+                                                       int limit) const
+{
+    return departureIndex.nextArrivals(stopId, currentTime, days, scheduleList, limit);
+}
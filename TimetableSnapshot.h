@@ -0,0 +1,58 @@
+#ifndef TIMETABLESNAPSHOT_H
+#define TIMETABLESNAPSHOT_H
+
+#include <QVector>
+#include <QSharedPointer>
+#include <QtGlobal>
+#include "Schedule.h"
+#include "Stop.h"
+#include "DepartureIndex.h"
+#include "StopRouteIndex.h"
+#include "DayMask.h"
+
+// Неизменяемая версия расписания для чтения из любых потоков.
+// TransportSchedule публикует новую версию после каждого изменения;
+// читатель берет std::shared_ptr на текущую и работает с ней без блокировок,
+// пока держит указатель. Векторы и индексы разделяются с предыдущей версией
+// неявно (copy-on-write Qt), поэтому публикация не копирует данные; первое
+// изменение после публикации неглубоко копирует внешние векторы.
+// Указатели на расписания действительны, пока жив снимок.
+class TimetableSnapshot
+{
+public:
+    TimetableSnapshot() = default;
+    TimetableSnapshot(quint64 version,
+                      QVector<Schedule> schedules,
+                      QVector<QSharedPointer<Stop>> stops,
+                      QVector<int> stopPositions,
+                      QVector<QSharedPointer<Stop>> activeStops,
+                      DepartureIndex departureIndex,
+                      StopRouteIndex stopRouteIndex);
+
+    quint64 version() const;
+    const QVector<Schedule>& schedules() const;
+    const QVector<QSharedPointer<Stop>>& stops() const;
+    const QVector<QSharedPointer<Stop>>& activeStops() const;
+    const DepartureIndex& departures() const;
+    const StopRouteIndex& stopRoutes() const;
+    QSharedPointer<Stop> findStop(StopId stopId) const;
+
+    QVector<const Schedule*> schedulesForDay(DayMask days) const;
+    QVector<const Schedule*> schedulesForStop(StopId stopId) const;
+    QVector<const Schedule*> routesBetweenStops(StopId fromStop, StopId toStop) const;
+    // Ближайший рейс каждого маршрута через остановку
+    QVector<TripArrival> nextTransport(StopId stopId, const TimeTransport& currentTime, DayMask days) const;
+    // Ближайшие limit прибытий на остановку
+    QVector<TripArrival> nextDepartures(StopId stopId, const TimeTransport& currentTime, DayMask days, int limit) const;
+
+private:
+    quint64 snapshotVersion = 0;
+    QVector<Schedule> scheduleList;
+    QVector<QSharedPointer<Stop>> stopList;
+    QVector<int> stopPositions; // StopId -> индекс в stopList (-1, если нет)
+    QVector<QSharedPointer<Stop>> activeStopList;
+    DepartureIndex departureIndex;
+    StopRouteIndex stopRouteIndex;
+};
+
+#endif // TIMETABLESNAPSHOT_H
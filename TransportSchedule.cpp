@@ -6,51 +6,153 @@
 #include "ValidationService.h"
 #include "SearchService.h"
 #include "StatisticsService.h"
+#include "GtfsImporter.h"
+#include "GtfsExporter.h"
+#include "ScheduleIndexFile.h"
+#include "TimetableSnapshot.h"
 #include <QFile>
+#include <QFileInfo>
+#include <QMultiHash>
+#include <QtConcurrent>
 #include <QTextStream>
 #include <QDateTime>
 #include <algorithm>
 #include <ranges>
 #include <QDebug>
 #include <climits>
+#include <utility>
 
 TransportSchedule::TransportSchedule(const QString& file, QObject* parent)
+    : TransportSchedule(file, StorageBackend::Auto, parent)
+{
+}
+
+TransportSchedule::TransportSchedule(const QString& file, StorageBackend backend, QObject* parent)
     : QObject(parent), filename(file),
+    currentSnapshot(std::make_shared<const TimetableSnapshot>()),
     scheduleReader(new ScheduleReader(this)),
-    scheduleWriter(new ScheduleWriter(this))
+    scheduleWriter(new ScheduleWriter(this)),
+    saveWatcher(new QFutureWatcher<void>(this)),
+    saveTimer(new QTimer(this))
 {
+    if (backend == StorageBackend::Sqlite
+        || (backend == StorageBackend::Auto && SqliteScheduleStorage::isDatabaseFile(file))) {
+        sqliteStorage = new SqliteScheduleStorage(file, this);
+    }
+
+    saveTimer->setSingleShot(true);
+    saveTimer->setInterval(SAVE_DEBOUNCE_MS);
+    connect(saveTimer, &QTimer::timeout, this, [this]() {
+        // Исключение не должно покидать цикл событий - сообщаем о нем сигналом
+        try {
+            saveAsync();
+        } catch (const FileOperationException& e) {
+            emit saveFinished(false, QString::fromUtf8(e.what()));
+        }
+    });
+    connect(saveWatcher, &QFutureWatcher<void>::finished, this, &TransportSchedule::onSaveFinished);
     loadFromFile();
 }
 
+TransportSchedule::~TransportSchedule()
+{
+    // Не оставляем незавершенную запись основного файла; несохраненные
+    // изменения уже есть в журнале и будут воспроизведены при загрузке
+    if (saveRunning) {
+        savePending = false;
+        saveWatcher->waitForFinished();
+        onSaveFinished();
+    }
+}
+
 void TransportSchedule::addRoute(const RouteParams& params)
 {
     // Создаем маршрут из параметров
     Route route = createRouteFromParams(params);
 
-    // Создаем расписание и добавляем его
-    Schedule schedule(route, params.startTime);
-    schedules.push_back(schedule);
+    if (auto validationResult = ValidationService::validateTrips(params.departures, params.frequencies);
+        !validationResult.isValid) {
+        throw InvalidRouteDataException(validationResult.errorMessage);
+    }
 
-    stopsDirty = true;
-    saveToFile();
+    // Рейсы с тем же шаблоном присоединяются к существующему расписанию
+    auto existing = std::ranges::find_if(schedules, [&route](const Schedule& s) {
+        return s.getRoute().hasSamePattern(route);
+    });
+
+    // Изменение сначала записывается в журнал (или базу) и только потом применяется:
+    // при ошибке записи исключение уходит вызывающему, а данные остаются прежними
+    if (existing != schedules.end()) {
+        Schedule merged = *existing;
+        for (const auto& departure : params.departures) {
+            merged.addDeparture(departure);
+        }
+        for (const auto& frequency : params.frequencies) {
+            merged.addFrequency(frequency);
+        }
+        journalPut(merged);
+
+        statistics.removeSchedule(*existing);
+        *existing = std::move(merged);
+        statistics.addSchedule(*existing);
+        departureIndex.updateSchedule(static_cast<int>(std::distance(schedules.begin(), existing)), *existing);
+        publishSnapshot();
+        emit routeUpdated(route.getRouteNumber(), snapshotVersion);
+    } else {
+        Schedule schedule(route, params.departures);
+        schedule.setFrequencies(params.frequencies);
+        journalPut(schedule);
+
+        schedules.push_back(std::move(schedule));
+        departureIndex.addSchedule(schedules.size() - 1, schedules.last());
+        stopRouteIndex.addSchedule(schedules.size() - 1, schedules.last());
+        activeStopsDirty |= stopUsage.addSchedule(schedules.last());
+        statistics.addSchedule(schedules.last());
+        publishSnapshot();
+        emit routeAdded(route.getRouteNumber(), snapshotVersion);
+    }
 
     qDebug() << "Добавлен маршрут №" << params.transport.getId() << "с"
-             << (params.intermediateStops.size() + 2) << "остановками";
+             << (params.intermediateStops.size() + 2) << "остановками и"
+             << params.departures.size() << "рейсами и"
+             << params.frequencies.size() << "частотными интервалами";
 }
 
 void TransportSchedule::removeRoute(int routeNumber)
 {
-    auto [it, end] = std::ranges::remove_if(schedules,
-                                            [routeNumber](const Schedule& s) {
-                                                return s.getRoute().getRouteNumber() == routeNumber;
-                                            });
-    if (it != end) {
-        schedules.erase(it, end);
-        stopsDirty = true;
-        saveToFile();
-    } else {
+    if (std::ranges::none_of(schedules, [routeNumber](const Schedule& s) {
+            return s.getRoute().getRouteNumber() == routeNumber;
+        })) {
         throw RouteNotFoundException(routeNumber);
     }
+
+    // Удаление применяется только после успешной записи в журнал
+    journalRemove(routeNumber);
+
+    // На место удаленного расписания переносится последнее: индексы обновляются
+    // только на остановках этих двух маршрутов, а не по всей сети.
+    // Обход с конца - перенесенное расписание уже проверено
+    for (int i = schedules.size() - 1; i >= 0; --i) {
+        if (schedules[i].getRoute().getRouteNumber() != routeNumber) {
+            continue;
+        }
+
+        departureIndex.removeSchedule(i, schedules[i]);
+        stopRouteIndex.removeSchedule(i, schedules[i]);
+        activeStopsDirty |= stopUsage.removeSchedule(schedules[i]);
+        statistics.removeSchedule(schedules[i]);
+
+        const int lastIndex = schedules.size() - 1;
+        if (i != lastIndex) {
+            departureIndex.moveSchedule(lastIndex, i, schedules[lastIndex]);
+            stopRouteIndex.moveSchedule(lastIndex, i, schedules[lastIndex]);
+            schedules[i] = std::move(schedules[lastIndex]);
+        }
+        schedules.removeLast();
+    }
+
+    publishSnapshot();
+    emit routeRemoved(routeNumber, snapshotVersion);
 }
 
 void TransportSchedule::updateRoute(int oldRouteNumber, const RouteParams& params)
@@ -64,6 +166,132 @@ void TransportSchedule::updateRoute(int oldRouteNumber, const RouteParams& param
     qDebug() << "Маршрут №" << oldRouteNumber << "обновлен на №" << params.transport.getId();
 }
 
+void TransportSchedule::Transaction::addRoute(const RouteParams& params)
+{
+    operations.push_back(Operation{Kind::Add, params.transport.getId(), params, std::nullopt});
+}
+
+void TransportSchedule::Transaction::removeRoute(int routeNumber)
+{
+    operations.push_back(Operation{Kind::Remove, routeNumber, std::nullopt, std::nullopt});
+}
+
+void TransportSchedule::Transaction::updateRoute(int oldRouteNumber, const RouteParams& params)
+{
+    operations.push_back(Operation{Kind::Update, oldRouteNumber, params, std::nullopt});
+}
+
+void TransportSchedule::Transaction::updatePattern(const Route& pattern, const RouteParams& params)
+{
+    operations.push_back(Operation{Kind::UpdatePattern, pattern.getRouteNumber(), params, pattern});
+}
+
+bool TransportSchedule::Transaction::isEmpty() const
+{
+    return operations.isEmpty();
+}
+
+int TransportSchedule::Transaction::size() const
+{
+    return operations.size();
+}
+
+void TransportSchedule::Transaction::clear()
+{
+    operations.clear();
+}
+
+void TransportSchedule::commitTransaction(const Transaction& transaction)
+{
+    if (transaction.isEmpty()) {
+        return;
+    }
+
+    // Проверяем все операции до изменения данных
+    QVector<Route> routes;
+    for (const auto& operation : transaction.operations) {
+        if (!operation.params) {
+            continue;
+        }
+        routes.push_back(createRouteFromParams(*operation.params));
+        if (auto validationResult = ValidationService::validateTrips(operation.params->departures,
+                                                                     operation.params->frequencies);
+            !validationResult.isValid) {
+            throw InvalidRouteDataException(validationResult.errorMessage);
+        }
+    }
+
+    // Операции применяются к копии (copy-on-write), исходный вектор не меняется до записи
+    QVector<Schedule> staged = schedules;
+    int nextRoute = 0;
+    for (const auto& operation : transaction.operations) {
+        if (operation.kind != Transaction::Kind::Add) {
+            auto [it, end] = std::ranges::remove_if(staged, [&operation](const Schedule& s) {
+                return operation.pattern ? s.getRoute().hasSamePattern(*operation.pattern)
+                                         : s.getRoute().getRouteNumber() == operation.routeNumber;
+            });
+            if (it == end) {
+                throw RouteNotFoundException(operation.routeNumber);
+            }
+            staged.erase(it, end);
+        }
+        if (!operation.params) {
+            continue;
+        }
+
+        // Рейсы с тем же шаблоном присоединяются к существующему расписанию
+        const Route& route = routes[nextRoute++];
+        auto existing = std::ranges::find_if(staged, [&route](const Schedule& s) {
+            return s.getRoute().hasSamePattern(route);
+        });
+        if (existing != staged.end()) {
+            for (const auto& departure : operation.params->departures) {
+                existing->addDeparture(departure);
+            }
+            for (const auto& frequency : operation.params->frequencies) {
+                existing->addFrequency(frequency);
+            }
+        } else {
+            Schedule schedule(route, operation.params->departures);
+            schedule.setFrequencies(operation.params->frequencies);
+            staged.push_back(schedule);
+        }
+    }
+
+    replaceSchedules(std::move(staged));
+    qDebug() << "Применен пакет из" << transaction.size() << "изменений, маршрутов:" << schedules.size();
+}
+
+void TransportSchedule::replaceSchedules(QVector<Schedule> staged)
+{
+    // Индексы строятся один раз, запись - одна на весь набор изменений
+    QVector<Schedule> previousSchedules = std::exchange(schedules, std::move(staged));
+    DepartureIndex previousDepartureIndex = departureIndex;
+    StopRouteIndex previousStopRouteIndex = stopRouteIndex;
+    StopUsageIndex previousStopUsage = stopUsage;
+    ScheduleStatistics previousStatistics = statistics;
+    departureIndex.build(schedules);
+    stopRouteIndex.build(schedules);
+    stopUsage.build(schedules);
+    statistics.build(schedules);
+
+    // Данные публикуются только после записи: при ошибке расписание остается прежним
+    try {
+        saveToFile();
+    } catch (const TransportScheduleException&) {
+        schedules = std::move(previousSchedules);
+        departureIndex = std::move(previousDepartureIndex);
+        stopRouteIndex = std::move(previousStopRouteIndex);
+        stopUsage = std::move(previousStopUsage);
+        statistics = std::move(previousStatistics);
+        throw;
+    }
+
+    activeStopsDirty = true;
+    publishSnapshot();
+    emit scheduleReset(snapshotVersion);
+}
+
 // Вспомогательный метод для создания маршрута из параметров
 Route TransportSchedule::createRouteFromParams(const RouteParams& params) const
 {
@@ -82,124 +310,354 @@ Route TransportSchedule::createRouteFromParams(const RouteParams& params) const
     }
 
     // Создаем маршрут
-    Route route(params.transport, params.startStop, params.endStop);
+    Route route(params.transport, params.startStop->getId(), params.endStop->getId());
     route.setDays(params.days);
 
     // Добавляем промежуточные остановки
     const int intermediateStopCount = allRouteStops.size() >= 2 ? static_cast<int>(allRouteStops.size()) - 2 : 0;
     for (int i = 0; i < intermediateStopCount; ++i) {
         const int stopIndex = i + 1;
-        route.addStop(allRouteStops[stopIndex], params.travelTimes[i]);
+        route.addStop(allRouteStops[stopIndex]->getId(), params.travelTimes[i]);
     }
 
     // Добавляем время до конечной остановки
     route.addFinalTravelTime(params.travelTimes.last());
 
-    // Рассчитываем время прибытия с использованием ArrivalTimeService
-    route.calculateArrivalTimes(params.startTime);
-
     return route;
 }
 
 // Остальные методы без изменений
-QVector<Schedule> TransportSchedule::getSchedulesForDay(const QString& day) const
+QVector<const Schedule*> TransportSchedule::getSchedulesForDay(const QString& day) const
+{
+    return SearchService::findSchedulesByDay(schedules, DayMask::fromStringList({day}));
+}
+
+QVector<const Schedule*> TransportSchedule::getSchedulesForStop(const QString& stopName) const
 {
-    return SearchService::findSchedulesByDay(schedules, day);
+    return getSchedulesForStop(findStopId(stopName));
 }
 
-QVector<Schedule> TransportSchedule::getSchedulesForStop(const QString& stopName) const
+QVector<const Schedule*> TransportSchedule::getSchedulesForStop(StopId stopId) const
 {
-    return SearchService::findSchedulesByStop(schedules, stopName);
+    return SearchService::findSchedulesByStop(schedules, stopRouteIndex, stopId);
 }
 
-QVector<Schedule> TransportSchedule::findNextTransport(const QString& stopName) const
+QVector<const Schedule*> TransportSchedule::findRoutesBetweenStops(StopId fromStop, StopId toStop) const
+{
+    return SearchService::findRoutesBetweenStops(schedules, stopRouteIndex, fromStop, toStop);
+}
+
+QVector<TripArrival> TransportSchedule::findNextTransport(const QString& stopName) const
+{
+    return findNextTransport(findStopId(stopName));
+}
+
+QVector<TripArrival> TransportSchedule::findNextTransport(StopId stopId) const
 {
     TimeTransport currentTime = getCurrentTime();
     QString currentDay = DayOfWeekService::getCurrentDay();
+    const DayMask today = DayOfWeekService::getCurrentDayMask();
 
-    qDebug() << "Поиск транспорта для остановки:" << stopName;
+    qDebug() << "Поиск транспорта для остановки:" << StopRegistry::instance().name(stopId);
     qDebug() << "Текущий день:" << currentDay;
     qDebug() << "Текущее время:" << currentTime.toString();
 
-    QVector<Schedule> result;
+    // Ближайший рейс каждого маршрута берется из индекса отправлений остановки
+    QVector<TripArrival> result = departureIndex.nextArrivalPerSchedule(stopId, currentTime, today, schedules);
 
-    for (const auto& schedule : schedules) {
-        const auto& route = schedule.getRoute();
+    qDebug() << "Всего найдено маршрутов:" << result.size();
+    return result;
+}
 
-        // Используем DayOfWeekService для проверки работы маршрута сегодня
-        if (!DayOfWeekService::isRouteActiveToday(route.getDays())) {
-            qDebug() << "Маршрут" << route.getRouteNumber() << "не работает сегодня";
-            continue;
+QVector<TripArrival> TransportSchedule::findNextDepartures(StopId stopId, int limit) const
+{
+    return departureIndex.nextArrivals(stopId, getCurrentTime(), DayOfWeekService::getCurrentDayMask(),
+                                       schedules, limit);
+}
+
+void TransportSchedule::saveToFile() const
+{
+    if (!scheduleWriter) {
+        throw TransportScheduleException("ScheduleWriter не инициализирован");
+    }
+
+    if (sqliteStorage) {
+        if (!sqliteStorage->saveAll(schedules, allStops)) {
+            throw FileOperationException(QString("Не удалось сохранить расписание в базу: %1").arg(sqliteStorage->lastError()));
         }
+        qDebug() << "Schedule successfully saved to database:" << filename;
+        return;
+    }
 
-        // Проверяем, проходит ли маршрут через указанную остановку
-        bool hasStop = false;
-        for (const auto& routeStop : route.getStops()) {
-            if (routeStop.stop->getName().compare(stopName, Qt::CaseInsensitive) == 0) {
-                hasStop = true;
-                break;
-            }
+    // Полная запись включает все изменения журнала - дожидаемся фоновой записи и очищаем его
+    if (saveRunning) {
+        saveWatcher->waitForFinished();
+    }
+
+    if (!scheduleWriter->writeToFile(filename, schedules, allStops)) {
+        throw FileOperationException(QString("Не удалось сохранить расписание в файл: %1").arg(filename));
+    } else {
+        QFile::remove(journalFilename() + ".compacting");
+        QFile::remove(journalFilename());
+        qDebug() << "Schedule successfully saved to:" << filename;
+        writeIndexFile();
+    }
+}
+
+void TransportSchedule::writeIndexFile() const
+{
+    // Файл индексов - только ускорение загрузки, ошибка записи не критична
+    QString error;
+    if (!ScheduleIndexFile::write(filename, allStops, schedules.size(), departureIndex, stopRouteIndex, &error)) {
+        qDebug() << "Не удалось сохранить индексы расписания:" << error;
+    }
+}
+
+QString TransportSchedule::journalFilename() const
+{
+    return filename + ".journal";
+}
+
+void TransportSchedule::journalPut(const Schedule& schedule)
+{
+    QVector<QSharedPointer<Stop>> routeStops;
+    for (const auto& routeStop : schedule.getRoute().getStops()) {
+        if (auto stop = findStop(routeStop.stopId)) {
+            routeStops.push_back(stop);
         }
+    }
 
-        if (!hasStop) {
-            qDebug() << "Маршрут" << route.getRouteNumber() << "не проходит через остановку" << stopName;
-            continue;
+    if (sqliteStorage) {
+        if (!sqliteStorage->putSchedule(schedule, routeStops)) {
+            throw FileOperationException(QString("Не удалось записать изменение в базу: %1").arg(sqliteStorage->lastError()));
         }
+        return;
+    }
 
-        // Получаем время прибытия на остановку
-        try {
-            TimeTransport arrivalTime = route.getArrivalTimeAtStop(stopName);
+    if (!scheduleWriter->appendJournalPut(journalFilename(), schedule, routeStops)) {
+        throw FileOperationException(QString("Не удалось записать изменение в журнал: %1").arg(journalFilename()));
+    }
+    compactJournalIfNeeded();
+}
+
+void TransportSchedule::journalRemove(int routeNumber)
+{
+    if (sqliteStorage) {
+        if (!sqliteStorage->removeRoute(routeNumber)) {
+            throw FileOperationException(QString("Не удалось записать изменение в базу: %1").arg(sqliteStorage->lastError()));
+        }
+        return;
+    }
+
+    if (!scheduleWriter->appendJournalRemove(journalFilename(), routeNumber)) {
+        throw FileOperationException(QString("Не удалось записать изменение в журнал: %1").arg(journalFilename()));
+    }
+    compactJournalIfNeeded();
+}
+
+void TransportSchedule::compactJournalIfNeeded()
+{
+    if (QFileInfo(journalFilename()).size() > JOURNAL_COMPACTION_THRESHOLD) {
+        scheduleSave();
+    }
+}
+
+void TransportSchedule::compactJournal()
+{
+    saveAsync();
+}
+
+void TransportSchedule::scheduleSave()
+{
+    // Повторный запуск таймера объединяет серию изменений в одну запись
+    saveTimer->start();
+}
 
-            // Используем ArrivalTimeService для расчета времени ожидания
-            int waitMinutes = ArrivalTimeService::calculateWaitTime(currentTime, arrivalTime);
+QFuture<void> TransportSchedule::saveAsync()
+{
+    saveTimer->stop();
+
+    // База SQLite обновляется транзакцией на каждое изменение - фоновая запись не нужна
+    if (sqliteStorage) {
+        return QFuture<void>();
+    }
 
-            // Включаем в результат только если время ожидания разумное (до 24 часов)
-            if (waitMinutes >= 0 && waitMinutes <= 24 * 60) {
-                result.push_back(schedule);
+    // Пока идет запись, новые запросы объединяются в одну последующую
+    if (saveRunning) {
+        savePending = true;
+        return saveWatcher->future();
+    }
 
-                qDebug() << "Найден маршрут:" << route.getRouteNumber()
-                         << "Время прибытия:" << arrivalTime.toString()
-                         << "Ожидание:" << waitMinutes << "мин";
-            } else {
-                qDebug() << "Маршрут" << route.getRouteNumber() << "исключен: время ожидания" << waitMinutes << "мин";
+    // Текущий журнал откладывается: новые изменения пишутся в свежий журнал,
+    // а отложенный удаляется только после успешной записи основного файла
+    const QString journal = journalFilename();
+    const QString compacting = journal + ".compacting";
+    if (QFile::exists(compacting)) {
+        // Предыдущая запись не завершилась - присоединяем к ней текущий журнал
+        QFile source(journal);
+        QFile target(compacting);
+        if (source.exists()) {
+            if (!source.open(QIODevice::ReadOnly) || !target.open(QIODevice::WriteOnly | QIODevice::Append)
+                || target.write(source.readAll()) < 0) {
+                throw FileOperationException(QString("Не удалось объединить журнал: %1").arg(compacting));
             }
-        } catch (const StopNotFoundException& e) {
-            qDebug() << "Остановка не найдена в маршруте" << route.getRouteNumber() << ":" << e.what();
-            continue;
+            source.close();
+            target.close();
+            QFile::remove(journal);
         }
+    } else if (QFile::exists(journal) && !QFile::rename(journal, compacting)) {
+        throw FileOperationException(QString("Не удалось переименовать журнал: %1").arg(journal));
     }
 
-    // Сортируем по времени ожидания (от меньшего к большему)
-    std::ranges::sort(result,
-                      [stopName, currentTime](const Schedule& a, const Schedule& b) {
-                          try {
-                              TimeTransport timeA = a.getRoute().getArrivalTimeAtStop(stopName);
-                              TimeTransport timeB = b.getRoute().getArrivalTimeAtStop(stopName);
+    // Фоновая запись работает с опубликованным неизменяемым снимком
+    saveRunning = true;
+    saveError = QSharedPointer<QString>::create();
+    auto future = QtConcurrent::run(
+        [writer = scheduleWriter, target = filename, current = snapshot(), error = saveError]() {
+            if (!writer->writeToFile(target, current->schedules(), current->stops())) {
+                *error = QString("Не удалось сохранить расписание в файл: %1").arg(target);
+                return;
+            }
+            // Файл индексов помечается уже записанным файлом данных и строится из того же снимка
+            QString indexError;
+            if (!ScheduleIndexFile::write(target, current->stops(), current->schedules().size(),
+                                          current->departures(), current->stopRoutes(), &indexError)) {
+                qDebug() << "Не удалось сохранить индексы расписания:" << indexError;
+            }
+        });
+    saveWatcher->setFuture(future);
+    qDebug() << "Background save started for" << filename;
+    return future;
+}
 
-                              int waitA = ArrivalTimeService::calculateWaitTime(currentTime, timeA);
-                              int waitB = ArrivalTimeService::calculateWaitTime(currentTime, timeB);
+void TransportSchedule::onSaveFinished()
+{
+    if (!saveRunning) {
+        return;
+    }
+    saveRunning = false;
 
-                              return waitA < waitB;
-                          } catch (const StopNotFoundException&) {
-                              return false;
-                          }
-                      });
+    const bool success = saveError && saveError->isEmpty();
+    if (success) {
+        QFile::remove(journalFilename() + ".compacting");
+        qDebug() << "Schedule saved in background to" << filename;
+    } else {
+        qDebug() << "Background save failed, journal kept for replay:" << *saveError;
+    }
+    emit saveFinished(success, success ? QString() : *saveError);
 
-    qDebug() << "Всего найдено маршрутов:" << result.size();
-    return result;
+    if (savePending) {
+        savePending = false;
+        saveAsync();
+    }
 }
 
-void TransportSchedule::saveToFile() const
+int TransportSchedule::importGtfs(const QString& directory, const std::function<void(int)>& onProgress)
 {
-    if (!scheduleWriter) {
-        throw TransportScheduleException("ScheduleWriter не инициализирован");
+    GtfsImporter importer;
+    if (onProgress) {
+        connect(&importer, &GtfsImporter::progressChanged, this, onProgress);
     }
 
-    if (!scheduleWriter->writeToFile(filename, schedules, allStops)) {
-        throw FileOperationException(QString("Не удалось сохранить расписание в файл: %1").arg(filename));
-    } else {
-        qDebug() << "Schedule successfully saved to:" << filename;
+    auto stopResolver = [this](const QStringList& names, const QStringList& coordinates) {
+        return internStops(names, coordinates);
+    };
+
+    const auto result = importer.importFeed(directory, stopResolver);
+    if (!result.success) {
+        throw FileOperationException(QString("Не удалось импортировать GTFS: %1").arg(result.errorMessage));
+    }
+
+    // Импорт применяется к копии и публикуется только после успешной записи
+    QVector<Schedule> staged = schedules;
+
+    // Совпадающие шаблоны ищутся только среди маршрутов с тем же номером
+    QMultiHash<int, int> byRouteNumber;
+    for (int i = 0; i < staged.size(); ++i) {
+        byRouteNumber.insert(staged[i].getRoute().getRouteNumber(), i);
+    }
+
+    for (const auto& schedule : result.schedules) {
+        const int routeNumber = schedule.getRoute().getRouteNumber();
+        bool merged = false;
+        for (int index : byRouteNumber.values(routeNumber)) {
+            Schedule& target = staged[index];
+            if (target.getRoute().hasSamePattern(schedule.getRoute())) {
+                QVector<TimeTransport> departures(target.getDepartures().begin(), target.getDepartures().end());
+                departures += QVector<TimeTransport>(schedule.getDepartures().begin(), schedule.getDepartures().end());
+                target.setDepartures(departures);
+                for (const auto& frequency : schedule.getFrequencies()) {
+                    target.addFrequency(frequency);
+                }
+                merged = true;
+                break;
+            }
+        }
+        if (!merged) {
+            byRouteNumber.insert(routeNumber, staged.size());
+            staged.push_back(schedule);
+        }
+    }
+
+    // Импорт затрагивает большую часть данных - журнал не нужен, пишем файл целиком
+    replaceSchedules(std::move(staged));
+    return result.tripCount;
+}
+
+void TransportSchedule::exportGtfs(const QString& directory, const std::function<void(int)>& onProgress) const
+{
+    GtfsExporter exporter;
+    if (onProgress) {
+        connect(&exporter, &GtfsExporter::progressChanged, this, onProgress);
+    }
+
+    QString errorMessage;
+    if (!exporter.exportFeed(directory, schedules, allStops, &errorMessage)) {
+        throw FileOperationException(QString("Не удалось экспортировать GTFS: %1").arg(errorMessage));
+    }
+}
+
+QVector<SqliteScheduleStorage::NextDeparture> TransportSchedule::queryNextDepartures(const QString& stopName, int limit) const
+{
+    if (!sqliteStorage) {
+        throw TransportScheduleException("Запросы к базе доступны только при хранении в SQLite");
+    }
+    return sqliteStorage->findNextDepartures(stopName, DayOfWeekService::getCurrentDayMask(),
+                                             getCurrentTime().toMinutes(), limit);
+}
+
+int TransportSchedule::replayJournal(const QString& journalFile)
+{
+    auto stopResolver = [this](const QStringList& names, const QStringList& coordinates) {
+        return internStops(names, coordinates);
+    };
+
+    const auto records = scheduleReader->readJournal(journalFile, stopResolver);
+    for (const auto& record : records) {
+        if (record.type == ScheduleReader::JournalRecord::Type::Remove) {
+            auto [it, end] = std::ranges::remove_if(schedules, [&record](const Schedule& s) {
+                return s.getRoute().getRouteNumber() == record.routeNumber;
+            });
+            schedules.erase(it, end);
+            continue;
+        }
+
+        // Запись содержит расписание целиком: заменяем шаблон или добавляем новый
+        const Schedule& schedule = *record.schedule;
+        auto existing = std::ranges::find_if(schedules, [&schedule](const Schedule& s) {
+            return s.getRoute().hasSamePattern(schedule.getRoute());
+        });
+        if (existing != schedules.end()) {
+            *existing = schedule;
+        } else {
+            schedules.push_back(schedule);
+        }
+    }
+
+    if (!records.isEmpty()) {
+        qDebug() << "Replayed" << records.size() << "journal records from" << journalFile;
     }
+    return records.size();
 }
 
 void TransportSchedule::loadFromFile() {
@@ -207,17 +665,48 @@ void TransportSchedule::loadFromFile() {
         throw TransportScheduleException("ScheduleReader не инициализирован");
     }
 
-    // Используем лямбду с правильной сигнатурой
-    auto stopCreator = [this](const QString& name, const QString& coordinate) {
-        return findOrCreateStop(name, coordinate);
+    // Остановки разрешаются пакетно через хеш-индекс
+    auto stopResolver = [this](const QStringList& names, const QStringList& coordinates) {
+        return internStops(names, coordinates);
     };
 
-    auto result = scheduleReader->readFromFile(filename, stopCreator);
+    auto result = sqliteStorage ? sqliteStorage->load(stopResolver)
+                                : scheduleReader->readFromFile(filename, stopResolver);
 
     if (result.success) {
         schedules = result.schedules;
         allStops = result.allStops;
-        stopsDirty = true;
+        rebuildStopIndex();
+
+        // Изменения после последней полной записи: сначала отложенный журнал, затем текущий
+        int replayed = 0;
+        if (!sqliteStorage) {
+            replayed += replayJournal(journalFilename() + ".compacting");
+            replayed += replayJournal(journalFilename());
+        }
+
+        // Сохраненные индексы подходят, только если расписание совпадает с файлом данных
+        QString indexError;
+        const bool indexesLoaded = !sqliteStorage && replayed == 0
+            && ScheduleIndexFile::load(filename, allStops, schedules, departureIndex, stopRouteIndex, &indexError);
+        if (!indexesLoaded) {
+            departureIndex.build(schedules);
+            stopRouteIndex.build(schedules);
+            if (!sqliteStorage && replayed == 0) {
+                qDebug() << "Rebuilt schedule indexes:" << indexError;
+                writeIndexFile();
+            }
+        }
+        stopUsage.build(schedules);
+        statistics.build(schedules);
+        activeStopsDirty = true;
+        publishSnapshot();
+        emit scheduleReset(snapshotVersion);
+        // После воспроизведения журнала файл данных и индексы устарели:
+        // фоновая запись сожмет журнал и сохранит свежий файл индексов
+        if (replayed > 0) {
+            scheduleSave();
+        }
         qDebug() << "Successfully loaded" << schedules.size() << "schedules and" << allStops.size() << "stops from" << filename;
     } else {
         throw FileOperationException(QString("Не удалось загрузить расписание из файла: %1").arg(result.errorMessage));
@@ -229,40 +718,129 @@ void TransportSchedule::updateRoute(int oldRouteNumber, const Route& newRoute, c
     // Удаляем старый маршрут
     removeRoute(oldRouteNumber);
 
-    // Создаем новое расписание
-    Schedule newSchedule(newRoute, startTime);
-    schedules.push_back(newSchedule);
+    // Создаем новое расписание; в память оно попадает только после записи в журнал
+    Schedule schedule(newRoute, startTime);
+    journalPut(schedule);
 
-    stopsDirty = true;
-    saveToFile();
+    schedules.push_back(std::move(schedule));
+    departureIndex.addSchedule(schedules.size() - 1, schedules.last());
+    stopRouteIndex.addSchedule(schedules.size() - 1, schedules.last());
+    activeStopsDirty |= stopUsage.addSchedule(schedules.last());
+    statistics.addSchedule(schedules.last());
+    publishSnapshot();
+    emit routeAdded(newRoute.getRouteNumber(), snapshotVersion);
 
     qDebug() << "Маршрут №" << oldRouteNumber << "обновлен на №" << newRoute.getRouteNumber();
 }
 
 QSharedPointer<Stop> TransportSchedule::findOrCreateStop(const QString& name, const QString& coordinate)
+{
+    const int previousCount = allStops.size();
+    bool replaced = false;
+    auto stop = internStop(name, coordinate, &replaced);
+    publishStopChanges(previousCount, replaced);
+    return stop;
+}
+
+QSharedPointer<Stop> TransportSchedule::internStop(const QString& name, const QString& coordinate, bool* replaced)
 {
     // Валидация данных остановки
     if (auto validationResult = ValidationService::validateStopData(name, coordinate); !validationResult.isValid) {
         throw InvalidRouteDataException(validationResult.errorMessage);
     }
 
-    // Ищем остановку по имени (без учета регистра)
-    for (const auto& stop : allStops) {
-        if (stop->getName().compare(name, Qt::CaseInsensitive) == 0) {
-            // Если нашли остановку с таким именем, обновляем координату если нужно
-            if (!coordinate.isEmpty() && stop->getCoordinate() != coordinate) {
-                stop->setCoordinate(coordinate);
-            }
-            return stop;
+    // Ищем остановку по имени (без учета регистра) через индекс
+    if (auto stop = findStop(StopRegistry::instance().find(name))) {
+        // Если нашли остановку с таким именем, обновляем координату если нужно
+        // Опубликованная остановка не меняется на месте - ее могут читать через снимок
+        if (!coordinate.isEmpty() && stop->getCoordinate() != coordinate) {
+            auto updated = QSharedPointer<Stop>::create(*stop);
+            updated->setCoordinate(coordinate);
+            allStops[stopPositions[updated->getId()]] = updated;
+            activeStopsDirty |= stopUsage.isActive(updated->getId());
+            if (replaced) *replaced = true;
+            return updated;
         }
+        return stop;
     }
 
     auto newStop = QSharedPointer<Stop>::create(name, coordinate);
+    indexStop(newStop, static_cast<int>(allStops.size()));
     allStops.push_back(newStop);
-    stopsDirty = true;
     return newStop;
 }
 
+QVector<QSharedPointer<Stop>> TransportSchedule::resolveStops(const QStringList& names, const QStringList& coordinates)
+{
+    const int previousCount = allStops.size();
+    bool replaced = false;
+    auto result = internStops(names, coordinates, &replaced);
+    publishStopChanges(previousCount, replaced);
+    return result;
+}
+
+void TransportSchedule::publishStopChanges(int previousCount, bool replaced)
+{
+    // Найденные без изменений остановки не меняют версию данных
+    if (allStops.size() == previousCount && !replaced) {
+        return;
+    }
+    publishSnapshot();
+    for (int i = previousCount; i < allStops.size(); ++i) {
+        emit stopAdded(allStops[i]->getId(), snapshotVersion);
+    }
+}
+
+QVector<QSharedPointer<Stop>> TransportSchedule::internStops(const QStringList& names, const QStringList& coordinates,
+                                                             bool* replaced)
+{
+    // allStops не резервируется заранее: вектор разделяется со снимком,
+    // и резервирование копировало бы его, даже если все остановки уже известны
+    QVector<QSharedPointer<Stop>> result;
+    result.reserve(names.size());
+
+    for (int i = 0; i < names.size(); ++i) {
+        const QString coordinate = i < coordinates.size() ? coordinates[i] : QString();
+        result.push_back(internStop(names[i], coordinate, replaced));
+    }
+
+    return result;
+}
+
+QSharedPointer<Stop> TransportSchedule::findStop(StopId stopId) const
+{
+    if (stopId >= static_cast<StopId>(stopPositions.size())) {
+        return {};
+    }
+    const int position = stopPositions[stopId];
+    return position >= 0 ? allStops[position] : QSharedPointer<Stop>();
+}
+
+void TransportSchedule::indexStop(const QSharedPointer<Stop>& stop, int position)
+{
+    const StopId stopId = stop->getId();
+    if (stopId >= static_cast<StopId>(stopPositions.size())) {
+        const int registrySize = StopRegistry::instance().size();
+        stopPositions.insert(stopPositions.size(), registrySize - stopPositions.size(), -1);
+    }
+    if (stopPositions[stopId] < 0) {
+        stopPositions[stopId] = position;
+    }
+}
+
+void TransportSchedule::rebuildStopIndex()
+{
+    stopPositions.fill(-1, StopRegistry::instance().size());
+    for (int i = 0; i < allStops.size(); ++i) {
+        indexStop(allStops[i], i);
+    }
+}
+
+StopId TransportSchedule::findStopId(const QString& name) const
+{
+    return StopRegistry::instance().find(name);
+}
+
 QVector<QSharedPointer<Stop>> TransportSchedule::getAllStops() const
 {
     return allStops;
@@ -270,39 +848,54 @@ QVector<QSharedPointer<Stop>> TransportSchedule::getAllStops() const
 
 QVector<QSharedPointer<Stop>> TransportSchedule::getActiveStops() const
 {
-    if (stopsDirty) {
-        updateActiveStops();
-    }
-    return activeStops;
+    return snapshot()->activeStops();
 }
 
-void TransportSchedule::updateActiveStops() const {
-    QSet<QString> usedStopNames;
+std::shared_ptr<const TimetableSnapshot> TransportSchedule::snapshot() const
+{
+    return currentSnapshot.load(std::memory_order_acquire);
+}
 
-    // Собираем все остановки, которые используются в активных маршрутах
-    for (const auto& schedule : schedules) {
-        const auto& route = schedule.getRoute();
-        for (const auto& routeStop : route.getStops()) {
-            usedStopNames.insert(routeStop.getName().toLower());
-        }
-    }
+quint64 TransportSchedule::dataVersion() const
+{
+    return snapshotVersion;
+}
 
-    // Создаем список активных остановок (уникальных по имени)
-    activeStops.clear();
-    QSet<QString> addedNames;
+quint64 TransportSchedule::activeStopsVersion() const
+{
+    return activeStopsChangedAt;
+}
 
-    for (const auto& stop : allStops) {
-        auto stopNameLower = stop->getName().toLower();
-        if (usedStopNames.contains(stopNameLower) && !addedNames.contains(stopNameLower)) {
-            activeStops.push_back(stop);
-            addedNames.insert(stopNameLower);
+void TransportSchedule::publishSnapshot()
+{
+    // Список активных остановок пересобирается только при изменении их набора
+    // или замене одной из них, за O(число активных остановок)
+    if (activeStopsDirty) {
+        activeStopList.clear();
+        activeStopList.reserve(stopUsage.activeStops().size());
+        for (StopId stopId : stopUsage.activeStops()) {
+            if (auto stop = findStop(stopId)) {
+                activeStopList.push_back(stop);
+            }
         }
     }
 
-    stopsDirty = false;
+    // Копии векторов и индексов разделяют данные с текущими (copy-on-write).
+    // Следующее изменение один раз неглубоко копирует внешние векторы (schedules,
+    // allStops, внешние векторы индексов); списки по остановкам копируются
+    // только для остановок затронутого маршрута
+    currentSnapshot.store(std::make_shared<const TimetableSnapshot>(++snapshotVersion, schedules, allStops, stopPositions,
+                                                                    activeStopList, departureIndex, stopRouteIndex),
+                          std::memory_order_release);
+
+    if (activeStopsDirty) {
+        activeStopsDirty = false;
+        activeStopsChangedAt = snapshotVersion;
+        emit stopsChanged(snapshotVersion);
+    }
 }
 
-QVector<Schedule> TransportSchedule::getAllSchedules() const
+const QVector<Schedule>& TransportSchedule::getAllSchedules() const
 {
     return schedules;
 }
@@ -332,15 +925,16 @@ QString TransportSchedule::getCurrentDayOfWeek() const
 
 StatisticsService::RouteStats TransportSchedule::getRouteStatistics() const
 {
-    return StatisticsService::calculateRouteStatistics(schedules);
+    return StatisticsService::calculateRouteStatistics(statistics);
 }
 
 StatisticsService::StopStats TransportSchedule::getStopStatistics() const
 {
-    return StatisticsService::calculateStopStatistics(schedules, allStops);
+    return StatisticsService::calculateStopStatistics(stopUsage, allStops.size(),
+                                                      [this](StopId stopId) { return findStop(stopId); });
 }
 
 QMap<QString, int> TransportSchedule::getDailyScheduleCount() const
 {
-    return StatisticsService::calculateDailyScheduleCount(schedules);
+    return StatisticsService::calculateDailyScheduleCount(statistics);
 }
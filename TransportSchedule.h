@@ -5,11 +5,24 @@
 #include <QVector>
 #include <QString>
 #include <QSharedPointer>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <optional>
 #include <stdexcept>
 #include "Route.h"
 #include "Schedule.h"
+#include "DepartureIndex.h"
+#include "StopRouteIndex.h"
+#include "StopUsageIndex.h"
+#include "ScheduleStatistics.h"
+#include "TimetableSnapshot.h"
 #include "ScheduleReader.h"
 #include "ScheduleWriter.h"
+#include "SqliteScheduleStorage.h"
 #include "ArrivalTimeService.h"
 #include "DayOfWeekService.h"
 #include "ValidationService.h"
@@ -53,65 +66,188 @@ public:
         QSharedPointer<Stop> endStop;
         QVector<QSharedPointer<Stop>> intermediateStops;
         QVector<int> travelTimes;
-        QStringList days;
-        TimeTransport startTime;
+        DayMask days;
+        QVector<TimeTransport> departures;
+        QVector<FrequencyTrip> frequencies;
 
         RouteParams(const Transport& transport,
                     QSharedPointer<Stop> startStop,
                     QSharedPointer<Stop> endStop,
                     const QVector<QSharedPointer<Stop>>& intermediateStops,
                     const QVector<int>& travelTimes,
-                    const QStringList& days,
-                    const TimeTransport& startTime)
+                    DayMask days,
+                    const QVector<TimeTransport>& departures,
+                    const QVector<FrequencyTrip>& frequencies = {})
             : transport(transport), startStop(std::move(startStop)), endStop(std::move(endStop)),
             intermediateStops(intermediateStops), travelTimes(travelTimes),
-            days(days), startTime(startTime) {}
+            days(days), departures(departures), frequencies(frequencies) {}
+    };
+
+    // Пакет изменений маршрутов. Операции только накапливаются; commitTransaction
+    // проверяет и применяет их все сразу либо не применяет ни одной
+    class Transaction {
+    public:
+        void addRoute(const RouteParams& params);
+        void removeRoute(int routeNumber);
+        void updateRoute(int oldRouteNumber, const RouteParams& params);
+        // Замена одного шаблона (Route::hasSamePattern); другие шаблоны с тем же номером не затрагиваются
+        void updatePattern(const Route& pattern, const RouteParams& params);
+
+        bool isEmpty() const;
+        int size() const;
+        void clear();
+
+    private:
+        friend class TransportSchedule;
+
+        enum class Kind { Add, Remove, Update, UpdatePattern };
+        struct Operation {
+            Kind kind = Kind::Add;
+            int routeNumber = 0;
+            std::optional<RouteParams> params;
+            std::optional<Route> pattern; // только для UpdatePattern
+        };
+        QVector<Operation> operations;
     };
 
 private:
     QVector<Schedule> schedules;
     QVector<QSharedPointer<Stop>> allStops;
+    QVector<int> stopPositions; // StopId -> индекс в allStops (-1, если нет)
+    DepartureIndex departureIndex;
+    StopRouteIndex stopRouteIndex;
+    StopUsageIndex stopUsage;
+    ScheduleStatistics statistics;
+    // Активные остановки из stopUsage; пересобираются при публикации, если activeStopsDirty
+    QVector<QSharedPointer<Stop>> activeStopList;
+    bool activeStopsDirty = true;
     QString filename;
-    mutable QVector<QSharedPointer<Stop>> activeStops;
-    mutable bool stopsDirty = true;
+
+    // Опубликованная версия для читателей из других потоков
+    std::atomic<std::shared_ptr<const TimetableSnapshot>> currentSnapshot;
+    quint64 snapshotVersion = 0;
+    quint64 activeStopsChangedAt = 0;
 
     // Сервисы
     ScheduleReader* scheduleReader;
     ScheduleWriter* scheduleWriter;
+    // База SQLite вместо файла и журнала (nullptr для файлового хранения)
+    SqliteScheduleStorage* sqliteStorage = nullptr;
+
+    // Журнал изменений и фоновая запись основного файла
+    QFutureWatcher<void>* saveWatcher;
+    QTimer* saveTimer;
+    QSharedPointer<QString> saveError;
+    bool saveRunning = false;
+    bool savePending = false;
 
 public:
+    // Размер журнала, после которого он уплотняется в основной файл
+    static constexpr qint64 JOURNAL_COMPACTION_THRESHOLD = 1024 * 1024;
+    // Задержка, за которую серия изменений объединяется в одну запись
+    static constexpr int SAVE_DEBOUNCE_MS = 500;
+
+    // Способ хранения: Auto выбирает базу SQLite для файлов .sqlite и .db
+    enum class StorageBackend { Auto, File, Sqlite };
+
     explicit TransportSchedule(const QString& file, QObject* parent = nullptr);
-    ~TransportSchedule() override = default;
+    TransportSchedule(const QString& file, StorageBackend backend, QObject* parent = nullptr);
+    ~TransportSchedule() override;
 
     // Основные методы с использованием RouteParams
     void addRoute(const RouteParams& params);
     void removeRoute(int routeNumber);
     void updateRoute(int oldRouteNumber, const RouteParams& params);
+    // Применение пакета: одна проверка, одно построение индексов и одна полная запись.
+    // При ошибке проверки или записи расписание остается прежним
+    void commitTransaction(const Transaction& transaction);
 
     // Остальные методы без изменений
     void updateRoute(int oldRouteNumber, const Route& newRoute, const TimeTransport& startTime);
-    QVector<Schedule> getSchedulesForDay(const QString& day) const;
-    QVector<Schedule> getSchedulesForStop(const QString& stopName) const;
-    QVector<Schedule> findNextTransport(const QString& stopName) const;
+    QVector<const Schedule*> getSchedulesForDay(const QString& day) const;
+    QVector<const Schedule*> getSchedulesForStop(const QString& stopName) const;
+    QVector<const Schedule*> getSchedulesForStop(StopId stopId) const;
+    QVector<const Schedule*> findRoutesBetweenStops(StopId fromStop, StopId toStop) const;
+    QVector<TripArrival> findNextTransport(const QString& stopName) const;
+    QVector<TripArrival> findNextTransport(StopId stopId) const;
+    QVector<TripArrival> findNextDepartures(StopId stopId, int limit) const;
+
+    // Импорт распакованного фида GTFS; шаблоны, совпадающие с существующими,
+    // дополняют их рейсами. Возвращает число импортированных рейсов
+    int importGtfs(const QString& directory, const std::function<void(int)>& onProgress = {});
+    // Выгрузка всех рейсов в каталог фида GTFS
+    void exportGtfs(const QString& directory, const std::function<void(int)>& onProgress = {}) const;
     void saveToFile() const;
+    // Фоновая запись снимка; ошибка записи сообщается сигналом saveFinished
+    QFuture<void> saveAsync();
+    // Отложенная запись: изменения за SAVE_DEBOUNCE_MS объединяются
+    void scheduleSave();
     void loadFromFile();
+    // Ближайшие прибытия, вычисленные запросом к базе (только для хранения в SQLite)
+    QVector<SqliteScheduleStorage::NextDeparture> queryNextDepartures(const QString& stopName, int limit) const;
+    void compactJournal();
+    QString journalFilename() const;
     QVector<QSharedPointer<Stop>> getAllStops() const;
-    QVector<Schedule> getAllSchedules() const;
+    const QVector<Schedule>& getAllSchedules() const;
     QStringList getAllRouteNumbers() const;
 
     TimeTransport getCurrentTime() const;
     QString getCurrentDayOfWeek() const;
 
     QSharedPointer<Stop> findOrCreateStop(const QString& name, const QString& coordinate = "");
+    QVector<QSharedPointer<Stop>> resolveStops(const QStringList& names, const QStringList& coordinates = {});
+    StopId findStopId(const QString& name) const;
     QVector<QSharedPointer<Stop>> getActiveStops() const;
 
+    // Текущий снимок расписания; безопасно вызывать из любого потока.
+    // Остальные методы работают с изменяемыми данными и вызываются из GUI-потока
+    std::shared_ptr<const TimetableSnapshot> snapshot() const;
+    // Версия данных растет при каждом изменении; совпадение версий означает,
+    // что пересчитывать производные данные не нужно
+    quint64 dataVersion() const;
+    // Версия, при которой последний раз изменился список активных остановок
+    quint64 activeStopsVersion() const;
+
     StatisticsService::RouteStats getRouteStatistics() const;
     StatisticsService::StopStats getStopStatistics() const;
     QMap<QString, int> getDailyScheduleCount() const;
 
 private:
-    void updateActiveStops() const;
+    void publishSnapshot();
+    void publishStopChanges(int previousCount, bool replaced);
+    // replaced - признак замены найденной остановки копией с новыми координатами
+    QSharedPointer<Stop> internStop(const QString& name, const QString& coordinate, bool* replaced = nullptr);
+    QVector<QSharedPointer<Stop>> internStops(const QStringList& names, const QStringList& coordinates,
+                                              bool* replaced = nullptr);
+    QSharedPointer<Stop> findStop(StopId stopId) const;
+    void indexStop(const QSharedPointer<Stop>& stop, int position);
+    void rebuildStopIndex();
     Route createRouteFromParams(const RouteParams& params) const;
+    // Замена всех расписаний с перестроением индексов и полной записью; при ошибке записи откат
+    void replaceSchedules(QVector<Schedule> staged);
+
+    void journalPut(const Schedule& schedule);
+    void journalRemove(int routeNumber);
+    void compactJournalIfNeeded();
+    int replayJournal(const QString& journalFile);
+    void writeIndexFile() const;
+    void onSaveFinished();
+
+signals:
+    // Завершение фоновой записи; errorMessage - текст FileOperationException
+    void saveFinished(bool success, const QString& errorMessage);
+
+    // Изменения данных; version - значение dataVersion() после изменения.
+    // Правка маршрута через updateRoute приходит парой routeRemoved/routeAdded
+    void routeAdded(int routeNumber, quint64 version);
+    void routeRemoved(int routeNumber, quint64 version);
+    // Рейсы добавлены к существующему шаблону маршрута
+    void routeUpdated(int routeNumber, quint64 version);
+    void stopAdded(StopId stopId, quint64 version);
+    // Изменился список активных остановок
+    void stopsChanged(quint64 version);
+    // Загрузка, импорт или пакет изменений: данные нужно перечитать целиком
+    void scheduleReset(quint64 version);
 };
 
 #endif
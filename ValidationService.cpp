@@ -14,7 +14,7 @@ constexpr int ValidationService::MAX_COORDINATE_LENGTH;
 ValidationService::ValidationResult ValidationService::validateRouteData(int routeNumber,
                                                                          const QVector<QSharedPointer<Stop>>& stops,
                                                                          const QVector<int>& travelTimes,
-                                                                         const QStringList& days)
+                                                                         DayMask days)
 {
     if (routeNumber < MIN_ROUTE_NUMBER || routeNumber > MAX_ROUTE_NUMBER) {
         return ValidationResult(false,
@@ -96,6 +96,33 @@ ValidationService::ValidationResult ValidationService::validateTimeData(int hour
     return ValidationResult(true);
 }
 
+ValidationService::ValidationResult ValidationService::validateTrips(const QVector<TimeTransport>& departures,
+                                                                    const QVector<FrequencyTrip>& frequencies)
+{
+    if (departures.isEmpty() && frequencies.isEmpty()) {
+        return ValidationResult(false, "Укажите хотя бы одно время отправления");
+    }
+
+    for (const auto& departure : departures) {
+        if (auto result = validateTimeData(departure.hours, departure.minutes); !result.isValid) {
+            return result;
+        }
+    }
+
+    for (const auto& frequency : frequencies) {
+        if (frequency.getHeadway() <= 0) {
+            return ValidationResult(false, "Интервал движения должен быть больше 0 минут");
+        }
+        if (!frequency.isValid()) {
+            return ValidationResult(false,
+                                    QString("Начало интервала %1 позже его окончания")
+                                        .arg(frequency.toString()));
+        }
+    }
+
+    return ValidationResult(true);
+}
+
 ValidationService::ValidationResult ValidationService::validateTravelTimes(const QVector<int>& travelTimes, int expectedCount)
 {
     if (travelTimes.size() != expectedCount) {
@@ -152,3 +179,12 @@ ValidationService::ValidationResult ValidationService::validateDays(const QStrin
 
     return ValidationResult(true);
 }
+
+ValidationService::ValidationResult ValidationService::validateDays(DayMask days)
+{
+    if (days.isEmpty()) {
+        return ValidationResult(false, "Укажите дни работы маршрута");
+    }
+
+    return ValidationResult(true);
+}
@@ -6,6 +6,9 @@
 #include <QSharedPointer>
 #include "Route.h"
 #include "Stop.h"
+#include "DayMask.h"
+#include "TimeTransport.h"
+#include "FrequencyTrip.h"
 
 class ValidationService
 {
@@ -29,14 +32,17 @@ public:
     static ValidationResult validateRouteData(int routeNumber,
                                               const QVector<QSharedPointer<Stop>>& stops,
                                               const QVector<int>& travelTimes,
-                                              const QStringList& days);
+                                              DayMask days);
 
     static ValidationResult validateStopData(const QString& stopName, const QString& coordinate);
     static ValidationResult validateTimeData(int hours, int minutes);
+    static ValidationResult validateTrips(const QVector<TimeTransport>& departures,
+                                          const QVector<FrequencyTrip>& frequencies = {});
     static ValidationResult validateTravelTimes(const QVector<int>& travelTimes, int expectedCount);
     static bool isRouteNumberUnique(int routeNumber, const QVector<Route>& existingRoutes);
     static ValidationResult validateTransportType(const QString& transportType);
     static ValidationResult validateDays(const QStringList& days);
+    static ValidationResult validateDays(DayMask days);
 };
 
 #endif // VALIDATIONSERVICE_H
@@ -1,4 +1,5 @@
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QLocale>
 #include <QTranslator>
 #include "mainwindow.h"
@@ -17,8 +18,24 @@ int main(int argc, char *argv[])
         }
     }
 
-    MainWindow window;
-    window.show();
+    // --catalog <файл.bin> открывает снимок только для просмотра с ограниченным кэшем маршрутов
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption catalogOption("catalog", "Бинарный снимок расписания для просмотра", "file");
+    const QCommandLineOption budgetOption("catalog-budget", "Бюджет кэша маршрутов, МБ", "mb",
+                                          QString::number(ScheduleCatalog::DEFAULT_MEMORY_BUDGET / (1024 * 1024)));
+    parser.addOption(catalogOption);
+    parser.addOption(budgetOption);
+    parser.process(app);
+
+    std::unique_ptr<MainWindow> window;
+    if (parser.isSet(catalogOption)) {
+        const qsizetype budget = parser.value(budgetOption).toLongLong() * 1024 * 1024;
+        window = std::make_unique<MainWindow>(parser.value(catalogOption), budget);
+    } else {
+        window = std::make_unique<MainWindow>();
+    }
+    window->show();
 
     return QApplication::exec();
 }
@@ -1,10 +1,31 @@
 #include "mainwindow.h"
 #include <QIcon>
+#include <QFileDialog>
+#include <QProgressDialog>
+#include <QCoreApplication>
 #include <ranges>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), schedule(new TransportSchedule("transport_schedule.dat", this)) {
     setupUI();
+
+    // Таблица обновляется по событиям расписания только в строках измененного маршрута
+    connect(schedule, &TransportSchedule::routeAdded, this, &MainWindow::refreshRouteRows);
+    connect(schedule, &TransportSchedule::routeRemoved, this, &MainWindow::refreshRouteRows);
+    connect(schedule, &TransportSchedule::routeUpdated, this, &MainWindow::refreshRouteRows);
+    connect(schedule, &TransportSchedule::scheduleReset, this, &MainWindow::refreshTable);
+}
+
+MainWindow::MainWindow(const QString& catalogFile, qsizetype memoryBudget, QWidget *parent)
+    : QMainWindow(parent), catalog(std::make_unique<ScheduleCatalog>(memoryBudget)) {
+    QString error;
+    const bool opened = catalog->open(catalogFile, &error);
+    setupUI();
+    setWindowTitle(windowTitle() + " (просмотр)");
+
+    if (!opened) {
+        QMessageBox::critical(this, "Ошибка расписания", "Не удалось открыть снимок расписания: " + error);
+    }
 }
 
 void MainWindow::setupUI() {
@@ -36,6 +57,22 @@ void MainWindow::setupUI() {
     connect(statisticsButton, &QPushButton::clicked, this, &MainWindow::showStatistics);
     buttonLayout->addWidget(statisticsButton);
 
+    importGtfsButton = new QPushButton("Импорт GTFS");
+    connect(importGtfsButton, &QPushButton::clicked, this, &MainWindow::importGtfs);
+    buttonLayout->addWidget(importGtfsButton);
+
+    exportGtfsButton = new QPushButton("Экспорт GTFS");
+    connect(exportGtfsButton, &QPushButton::clicked, this, &MainWindow::exportGtfs);
+    buttonLayout->addWidget(exportGtfsButton);
+
+    // Снимок неизменяем, а поиск и статистика требуют загруженного расписания
+    if (catalog) {
+        for (auto* button : {addButton, findTransportButton, refreshButton, statisticsButton,
+                             importGtfsButton, exportGtfsButton}) {
+            button->setVisible(false);
+        }
+    }
+
     buttonLayout->addStretch();
     mainLayout->addLayout(buttonLayout);
 
@@ -44,21 +81,18 @@ void MainWindow::setupUI() {
     mainLayout->addWidget(routesTable);
 }
 
-void MainWindow::showRouteDetails(int routeNumber) {
+void MainWindow::showRouteDetails(const Route& pattern) {
     try {
-        auto allSchedules = schedule->getAllSchedules();
-
-        for (const auto& scheduleItem : allSchedules) {
-            if (scheduleItem.getRoute().getRouteNumber() == routeNumber) {
+        for (const auto& scheduleItem : schedule->getAllSchedules()) {
+            if (scheduleItem.getRoute().hasSamePattern(pattern)) {
                 auto* dialog = new RouteDetailsDialog(schedule, scheduleItem, this);
                 dialog->setAttribute(Qt::WA_DeleteOnClose);
-                connect(dialog, &RouteDetailsDialog::finished, this, &MainWindow::refreshTable);
                 dialog->exec();
                 return;
             }
         }
 
-        throw RouteNotFoundException(routeNumber);
+        throw RouteNotFoundException(pattern.getRouteNumber());
 
     } catch (const RouteNotFoundException& e) {
         QMessageBox::information(this, "Маршрут не найден", e.what());
@@ -67,13 +101,26 @@ void MainWindow::showRouteDetails(int routeNumber) {
     }
 }
 
+void MainWindow::showCatalogRoute(int scheduleIndex) {
+    // Маршрут собирается из снимка только сейчас и остается в кэше каталога
+    const auto scheduleItem = catalog->schedule(scheduleIndex);
+    if (!scheduleItem) {
+        QMessageBox::critical(this, "Ошибка расписания", "Не удалось прочитать маршрут из снимка");
+        return;
+    }
+
+    auto* dialog = new RouteDetailsDialog(nullptr, *scheduleItem, this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->exec();
+}
+
 void MainWindow::setupTable() {
     routesTable = new QTableWidget(this);
     routesTable->setColumnCount(7);
 
     // Устанавливаем заголовки
     QStringList headers;
-    headers << "Номер" << "Тип" << "Начальная остановка" << "Конечная остановка" << "Время начала" << "Дни работы" << "Действие";
+    headers << "Номер" << "Тип" << "Начальная остановка" << "Конечная остановка" << "Отправления" << "Дни работы" << "Действие";
     routesTable->setHorizontalHeaderLabels(headers);
 
     // Настраиваем отображение заголовков
@@ -94,77 +141,138 @@ void MainWindow::setupTable() {
 }
 
 void MainWindow::populateTable() {
+    if (catalog) {
+        populateCatalogTable();
+        return;
+    }
+
     routesTable->setRowCount(0);
-    auto allSchedules = schedule->getAllSchedules();
+    const auto& allSchedules = schedule->getAllSchedules();
 
-    // Сортируем маршруты по номеру в порядке возрастания
-    auto sortedSchedules = allSchedules;
-    std::ranges::sort(sortedSchedules,
-                      [](const Schedule& a, const Schedule& b) {
-                          return a.getRoute().getRouteNumber() < b.getRoute().getRouteNumber();
-                      });
+    // Сортируем маршруты по номеру в порядке возрастания (без копирования расписаний)
+    QVector<const Schedule*> sortedSchedules;
+    sortedSchedules.reserve(allSchedules.size());
+    for (const auto& sched : allSchedules) {
+        sortedSchedules.push_back(&sched);
+    }
+    std::ranges::stable_sort(sortedSchedules,
+                             [](const Schedule* a, const Schedule* b) {
+                                 return a->getRoute().getRouteNumber() < b->getRoute().getRouteNumber();
+                             });
 
     int row = 0;
-    for (const auto& sched : sortedSchedules) {
-        const auto& route = sched.getRoute();
-        auto routeNumber = route.getRouteNumber();
-
-        routesTable->insertRow(row);
-        routesTable->setItem(row, 0, new QTableWidgetItem(QString::number(routeNumber)));
-        routesTable->setItem(row, 1, new QTableWidgetItem(route.getTransport().getType().getName()));
-        routesTable->setItem(row, 2, new QTableWidgetItem(route.getStartStop()->getName()));
-        routesTable->setItem(row, 3, new QTableWidgetItem(route.getEndStop()->getName()));
-        routesTable->setItem(row, 4, new QTableWidgetItem(sched.getStartTime().toString()));
-        routesTable->setItem(row, 5, new QTableWidgetItem(route.getDays().join(", ")));
-
-        // Центрируем текст в ячейках
-        for (auto col = 0; col < 6; ++col) {
-            auto* item = routesTable->item(row, col);
-            if (item) {
-                item->setTextAlignment(Qt::AlignCenter);
-            }
+    for (const auto* sched : sortedSchedules) {
+        insertScheduleRow(row++, *sched);
+    }
+
+    resizeColumns();
+    tableVersion = schedule->dataVersion();
+}
+
+void MainWindow::insertScheduleRow(int row, const Schedule& sched) {
+    const auto& route = sched.getRoute();
+    auto routeNumber = route.getRouteNumber();
+
+    routesTable->insertRow(row);
+    routesTable->setItem(row, 0, new QTableWidgetItem(QString::number(routeNumber)));
+    routesTable->setItem(row, 1, new QTableWidgetItem(route.getTransport().getType().getName()));
+    routesTable->setItem(row, 2, new QTableWidgetItem(route.getStartStopName()));
+    routesTable->setItem(row, 3, new QTableWidgetItem(route.getEndStopName()));
+    routesTable->setItem(row, 4, new QTableWidgetItem(ArrivalTimeService::formatTrips(sched)));
+    routesTable->setItem(row, 5, new QTableWidgetItem(route.getDays().toString()));
+
+    // Центрируем текст в ячейках
+    for (auto col = 0; col < 6; ++col) {
+        auto* item = routesTable->item(row, col);
+        if (item) {
+            item->setTextAlignment(Qt::AlignCenter);
         }
+    }
 
-        // Создаем контейнер для кнопок
-        auto* buttonsWidget = new QWidget();
-        auto* buttonsLayout = new QHBoxLayout(buttonsWidget);
-        buttonsLayout->setContentsMargins(2, 2, 2, 2);
-        buttonsLayout->setSpacing(2);
-
-        // Кнопка "Показать маршрут"
-        auto* showRouteButton = new QToolButton();
-        showRouteButton->setIcon(QIcon::fromTheme("edit-find", QIcon(":/icons/route.png")));
-        showRouteButton->setText("Маршрут");
-        showRouteButton->setToolTip("Показать полный маршрут с остановками");
-        showRouteButton->setIconSize(QSize(16, 16));
-        showRouteButton->setStyleSheet("QToolButton { border: 1px solid #c0c0c0; border-radius: 3px; padding: 3px; background-color: #e8f4ff; }");
-
-        // Подключаем кнопку к слоту показа маршрута
-        connect(showRouteButton, &QToolButton::clicked, [this, routeNumber]() {
-            showRouteDetails(routeNumber);
-        });
+    // Создаем контейнер для кнопок
+    auto* buttonsWidget = new QWidget();
+    auto* buttonsLayout = new QHBoxLayout(buttonsWidget);
+    buttonsLayout->setContentsMargins(2, 2, 2, 2);
+    buttonsLayout->setSpacing(2);
+
+    // Кнопка "Показать маршрут"
+    auto* showRouteButton = createShowRouteButton();
+
+    // Подключаем кнопку к слоту показа маршрута
+    connect(showRouteButton, &QToolButton::clicked, [this, pattern = route]() {
+        showRouteDetails(pattern);
+    });
+
+    // Кнопка удаления
+    auto* deleteButton = new QToolButton();
+    deleteButton->setIcon(QIcon::fromTheme("edit-delete", QIcon(":/icons/delete.png")));
+    deleteButton->setText("Удалить");
+    deleteButton->setToolTip("Удалить маршрут");
+    deleteButton->setIconSize(QSize(16, 16));
+    deleteButton->setStyleSheet("QToolButton { border: 1px solid #c0c0c0; border-radius: 3px; padding: 3px; background-color: #ffe8e8; }");
+
+    connect(deleteButton, &QToolButton::clicked, [this, routeNumber]() {
+        removeRoute(routeNumber);
+    });
+
+    // Добавляем кнопки в layout
+    buttonsLayout->addWidget(showRouteButton);
+    buttonsLayout->addWidget(deleteButton);
+    buttonsLayout->setAlignment(Qt::AlignCenter);
+
+    routesTable->setCellWidget(row, 6, buttonsWidget);
+}
+
+void MainWindow::populateCatalogTable() {
+    routesTable->setRowCount(0);
 
-        // Кнопка удаления
-        auto* deleteButton = new QToolButton();
-        deleteButton->setIcon(QIcon::fromTheme("edit-delete", QIcon(":/icons/delete.png")));
-        deleteButton->setText("Удалить");
-        deleteButton->setToolTip("Удалить маршрут");
-        deleteButton->setIconSize(QSize(16, 16));
-        deleteButton->setStyleSheet("QToolButton { border: 1px solid #c0c0c0; border-radius: 3px; padding: 3px; background-color: #ffe8e8; }");
+    // Заголовки читаются из отображенного файла, полные маршруты не собираются
+    QVector<std::pair<int, ScheduleCatalog::RouteHeader>> headers;
+    headers.reserve(catalog->routeCount());
+    for (int i = 0; i < catalog->routeCount(); ++i) {
+        headers.push_back({i, *catalog->header(i)});
+    }
+    std::ranges::stable_sort(headers, {}, [](const auto& item) { return item.second.routeNumber; });
 
-        connect(deleteButton, &QToolButton::clicked, [this, routeNumber]() {
-            removeRoute(routeNumber);
-        });
+    routesTable->setRowCount(static_cast<int>(headers.size()));
+    int row = 0;
+    for (const auto& [scheduleIndex, header] : headers) {
+        insertCatalogRow(row++, scheduleIndex, header);
+    }
 
-        // Добавляем кнопки в layout
-        buttonsLayout->addWidget(showRouteButton);
-        buttonsLayout->addWidget(deleteButton);
-        buttonsLayout->setAlignment(Qt::AlignCenter);
+    resizeColumns();
+}
 
-        routesTable->setCellWidget(row, 6, buttonsWidget);
-        ++row;
+void MainWindow::insertCatalogRow(int row, int scheduleIndex, const ScheduleCatalog::RouteHeader& header) {
+    routesTable->setItem(row, 0, new QTableWidgetItem(QString::number(header.routeNumber)));
+    routesTable->setItem(row, 1, new QTableWidgetItem(header.transportType.getName()));
+    routesTable->setItem(row, 2, new QTableWidgetItem(header.firstStopName));
+    routesTable->setItem(row, 3, new QTableWidgetItem(header.lastStopName));
+    routesTable->setItem(row, 4, new QTableWidgetItem(QString("Рейсов: %1").arg(header.tripCount)));
+    routesTable->setItem(row, 5, new QTableWidgetItem(header.days.toString()));
+
+    for (auto col = 0; col < 6; ++col) {
+        routesTable->item(row, col)->setTextAlignment(Qt::AlignCenter);
     }
 
+    auto* showRouteButton = createShowRouteButton();
+    connect(showRouteButton, &QToolButton::clicked, [this, scheduleIndex]() {
+        showCatalogRoute(scheduleIndex);
+    });
+    routesTable->setCellWidget(row, 6, showRouteButton);
+}
+
+QToolButton* MainWindow::createShowRouteButton() {
+    auto* showRouteButton = new QToolButton();
+    showRouteButton->setIcon(QIcon::fromTheme("edit-find", QIcon(":/icons/route.png")));
+    showRouteButton->setText("Маршрут");
+    showRouteButton->setToolTip("Показать полный маршрут с остановками");
+    showRouteButton->setIconSize(QSize(16, 16));
+    showRouteButton->setStyleSheet("QToolButton { border: 1px solid #c0c0c0; border-radius: 3px; padding: 3px; background-color: #e8f4ff; }");
+    return showRouteButton;
+}
+
+void MainWindow::resizeColumns() {
     // Настраиваем ширину колонок
     routesTable->resizeColumnsToContents();
     routesTable->horizontalHeader()->setSectionResizeMode(2, QHeaderView::Stretch);
@@ -177,9 +285,7 @@ void MainWindow::populateTable() {
 
 void MainWindow::addRoute() {
     AddRouteDialog dialog(schedule, this);
-    if (dialog.exec() == QDialog::Accepted) {
-        refreshTable();
-    }
+    dialog.exec();
 }
 
 void MainWindow::removeRoute(int routeNumber) {
@@ -190,7 +296,6 @@ void MainWindow::removeRoute(int routeNumber) {
     if (reply == QMessageBox::Yes) {
         try {
             schedule->removeRoute(routeNumber);
-            refreshTable();
         } catch (const RouteNotFoundException& e) {
             QMessageBox::warning(this, "Маршрут не найден", e.what());
         } catch (const TransportScheduleException& e) {
@@ -205,9 +310,39 @@ void MainWindow::openFindTransportDialog() {
 }
 
 void MainWindow::refreshTable() {
+    // Данные не менялись с последнего заполнения - таблица актуальна
+    if (tableVersion == schedule->dataVersion()) {
+        return;
+    }
     populateTable();
 }
 
+void MainWindow::refreshRouteRows(int routeNumber, quint64 version) {
+    if (version <= tableVersion) {
+        return;
+    }
+
+    // Строки отсортированы по номеру: заменяем только строки этого маршрута
+    for (int row = routesTable->rowCount() - 1; row >= 0; --row) {
+        if (routesTable->item(row, 0)->text().toInt() == routeNumber) {
+            routesTable->removeRow(row);
+        }
+    }
+
+    int row = 0;
+    while (row < routesTable->rowCount() && routesTable->item(row, 0)->text().toInt() < routeNumber) {
+        ++row;
+    }
+    for (const auto& sched : schedule->getAllSchedules()) {
+        if (sched.getRoute().getRouteNumber() == routeNumber) {
+            insertScheduleRow(row++, sched);
+        }
+    }
+
+    resizeColumns();
+    tableVersion = version;
+}
+
 void MainWindow::showStatistics() {
     try {
         auto routeStats = schedule->getRouteStatistics();
@@ -217,6 +352,7 @@ void MainWindow::showStatistics() {
         statsText += QString("=== СТАТИСТИКА СИСТЕМЫ ===\n\n");
         statsText += QString("Маршруты:\n");
         statsText += QString("  Всего маршрутов: %1\n").arg(routeStats.totalRoutes);
+        statsText += QString("  Всего рейсов: %1\n").arg(routeStats.totalTrips);
         statsText += QString("  Автобусы: %1\n").arg(routeStats.busCount);
         statsText += QString("  Троллейбусы: %1\n").arg(routeStats.trolleybusCount);
         statsText += QString("  Трамваи: %1\n").arg(routeStats.tramCount);
@@ -242,3 +378,49 @@ void MainWindow::showStatistics() {
         QMessageBox::critical(this, "Ошибка статистики", e.what());
     }
 }
+
+void MainWindow::importGtfs() {
+    const QString directory = QFileDialog::getExistingDirectory(this, "Каталог с распакованным фидом GTFS");
+    if (directory.isEmpty()) {
+        return;
+    }
+
+    QProgressDialog progress("Импорт GTFS...", QString(), 0, 100, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(0);
+
+    try {
+        const int tripCount = schedule->importGtfs(directory, [&progress](int percent) {
+            progress.setValue(percent);
+            QCoreApplication::processEvents();
+        });
+        progress.close();
+        QMessageBox::information(this, "Импорт GTFS", QString("Импортировано рейсов: %1").arg(tripCount));
+    } catch (const TransportScheduleException& e) {
+        progress.close();
+        QMessageBox::critical(this, "Ошибка импорта", e.what());
+    }
+}
+
+void MainWindow::exportGtfs() {
+    const QString directory = QFileDialog::getExistingDirectory(this, "Каталог для фида GTFS");
+    if (directory.isEmpty()) {
+        return;
+    }
+
+    QProgressDialog progress("Экспорт GTFS...", QString(), 0, 100, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(0);
+
+    try {
+        schedule->exportGtfs(directory, [&progress](int percent) {
+            progress.setValue(percent);
+            QCoreApplication::processEvents();
+        });
+        progress.close();
+        QMessageBox::information(this, "Экспорт GTFS", "Расписание выгружено в " + directory);
+    } catch (const TransportScheduleException& e) {
+        progress.close();
+        QMessageBox::critical(this, "Ошибка экспорта", e.what());
+    }
+}
@@ -9,7 +9,9 @@
 #include <QHeaderView>
 #include <QMessageBox>
 #include <QToolButton>
+#include <memory>
 #include "TransportSchedule.h"
+#include "ScheduleCatalog.h"
 #include "AddRouteDialog.h"
 #include "FindTransportDialog.h"
 #include "RouteDetailsDialog.h"  // ДОБАВЛЯЕМ ЭТУ СТРОКУ
@@ -19,26 +21,45 @@ class MainWindow : public QMainWindow {
 
 public:
     explicit MainWindow(QWidget *parent = nullptr);
+    // Режим просмотра бинарного снимка: в памяти только заголовки маршрутов,
+    // полные маршруты собираются при открытии и держатся в кэше с бюджетом memoryBudget
+    MainWindow(const QString& catalogFile, qsizetype memoryBudget, QWidget *parent = nullptr);
 
 private slots:
     void addRoute();
     void removeRoute(int routeNumber);
-    void showRouteDetails(int routeNumber);
+    // pattern - шаблон строки таблицы: у номера маршрута может быть несколько шаблонов
+    void showRouteDetails(const Route& pattern);
+    void showCatalogRoute(int scheduleIndex);
     void openFindTransportDialog();
     void refreshTable();
+    void refreshRouteRows(int routeNumber, quint64 version);
     void showStatistics();
+    void importGtfs();
+    void exportGtfs();
 
 private:
     void setupUI();
     void setupTable();
     void populateTable();
+    void insertScheduleRow(int row, const Schedule& sched);
+    void populateCatalogTable();
+    void insertCatalogRow(int row, int scheduleIndex, const ScheduleCatalog::RouteHeader& header);
+    QToolButton* createShowRouteButton();
+    void resizeColumns();
 
-    TransportSchedule* schedule;
+    TransportSchedule* schedule = nullptr;
+    // Задан только в режиме просмотра; schedule при этом не создается
+    std::unique_ptr<ScheduleCatalog> catalog;
     QTableWidget* routesTable;
     QPushButton* addButton;
     QPushButton* findTransportButton;
     QPushButton* refreshButton;
     QPushButton* statisticsButton;
+    QPushButton* importGtfsButton;
+    QPushButton* exportGtfsButton;
+    // Версия данных расписания, отображенная в таблице
+    quint64 tableVersion = 0;
 };
 
 #endif